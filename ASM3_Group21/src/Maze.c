@@ -1,31 +1,60 @@
 #include "Maze.h"
-/* Display the maze. */
-void ShowMaze(const char *maze, int width, int height) {
-   int x, y;
-   for(y = 0; y < height; y++) {
-      for(x = 0; x < width; x++) {
-         switch(maze[y * width + x]) {
-         case 1:  printf("[]");  break;
-         case 2:  printf("<>");  break;
-         default: printf("  ");  break;
-         }
+#include "../uart/uart.h"
+#include "log.h"
+#include "clock.h"
+#include "stats.h"
+#include "string.h"
+/* Send one row of the maze as a single string, so it can go out by DMA. */
+static void send_row(const uint64_t *row, int width, int goal) {
+   char line[130];
+   int x, n = 0;
+   for(x = 0; x < width; x++) {
+      if ((row[x >> 6] >> (x & 63)) & 1) {
+         line[n++] = '[';  line[n++] = ']';
+      } else if (x == goal) {
+         line[n++] = '<';  line[n++] = '>';
+      } else {
+         line[n++] = ' ';  line[n++] = ' ';
+      }
+      if (n >= sizeof(line) - 2) {
+         line[n] = '\0';
+         uart_dma_puts(line);
+         n = 0;
       }
-      printf("\n");
+   }
+   line[n++] = '\n';
+   line[n] = '\0';
+   uart_dma_puts(line);
+}
+
+/* Display the maze. */
+void ShowMaze(const maze_map *m) {
+   for(int y = 0; y < m->height; y++) {
+      int goal = m->goal >= 0 && m->goal / m->width == y ? m->goal % m->width : -1;
+      send_row(maze_row(m, y), m->width, goal);
    }
 }
 
-static unsigned char our_memory[1024 * 1024]; //reserve 1 MB for malloc
+/* Scratch heap of the generators: room for mazes of up to 2000x2000 */
+#define MAZE_HEAP_SIZE (16 * 1024 * 1024)
+static unsigned char our_memory[MAZE_HEAP_SIZE] __attribute__((aligned(16)));
 static size_t next_index = 0;
+heap_counters maze_heap_stats;
 
 void *selfmalloc(size_t sz)
 {
     void *mem;
 
-    if(sizeof our_memory - next_index < sz)
+    sz = (sz + 15) & ~(size_t)15; // keep every block 16-byte aligned
+    if(sizeof our_memory - next_index < sz) {
+        STAT_INC(maze_heap_stats.failed);
         return NULL;
+    }
 
     mem = &our_memory[next_index];
     next_index += sz;
+    STAT_ADD(maze_heap_stats.allocated, sz);
+    STAT_SET(maze_heap_stats.live, next_index);
     return mem;
 }
 
@@ -62,153 +91,470 @@ int rand_range(int min, int max) {
 }
 
 
-/*  Carve the maze starting at x, y. */
-void CarveMaze(char *maze, int width, int height, int x, int y) {
-
-   int x1, y1;
-   int x2, y2;
-   int dx, dy;
-   int dir, count;
-
-   dir = rand_range(1,100) % 4;
-   count = 0;
-   while(count < 4) {
-      dx = 0; dy = 0;
-      switch(dir) {
-      case 0:  dx = 1;  break;
-      case 1:  dy = 1;  break;
-      case 2:  dx = -1; break;
-      default: dy = -1; break;
-      }
-      x1 = x + dx;
-      y1 = y + dy;
-      x2 = x1 + dx;
-      y2 = y1 + dy;
-      if(   x2 > 0 && x2 < width && y2 > 0 && y2 < height
-         && maze[y1 * width + x1] == 1 && maze[y2 * width + x2] == 1) {
-         maze[y1 * width + x1] = 0;
-         maze[y2 * width + x2] = 0;
-         x = x2; y = y2;
-         dir = rand_range(1,100) % 4;
-         count = 0;
-      } else {
-         dir = (dir + 1) % 4;
-         count += 1;
+/* Scratch space of the generators, kept between calls since the bump
+   allocator never frees: grows only for a larger maze. work holds three
+   words per cell (the Prim frontier, the backtracker stack, the Wilson
+   walk or the Kruskal forest and edge list). */
+static unsigned int *work;
+static unsigned long *in_maze, *in_frontier;
+static int scratch_cells = 0;
+
+#define BIT_TEST(set, i) ((set)[(i) >> 6] & (1UL << ((i) & 63)))
+#define BIT_SET(set, i) ((set)[(i) >> 6] |= 1UL << ((i) & 63))
+#define BIT_CLEAR(set, i) ((set)[(i) >> 6] &= ~(1UL << ((i) & 63)))
+
+static int maze_scratch(int cells)
+{
+   if (cells <= scratch_cells)
+      return 1;
+   int words = (cells + 63) / 64;
+   unsigned long *a = (unsigned long*)selfmalloc(words * sizeof(unsigned long));
+   unsigned long *b = (unsigned long*)selfmalloc(words * sizeof(unsigned long));
+   unsigned int *w = (unsigned int*)selfmalloc(3UL * cells * sizeof(unsigned int));
+   if (a == NULL || b == NULL || w == NULL)
+      return 0;
+   in_maze = a;
+   in_frontier = b;
+   work = w;
+   scratch_cells = cells;
+   return 1;
+}
+
+/*
+* Cells sit on even coordinates, the odd rows and columns between them are
+* walls: a grid of width x height holds cw x ch cells. Cell c is at column
+* c % cw, row c / cw.
+*/
+
+/* The neighbour of cell c towards north, east, south or west (d = 0..3), -1 outside */
+static inline int cell_step(int c, int d, int cw, int ch)
+{
+   switch (d) {
+   case 0:  return c >= cw ? c - cw : -1;
+   case 1:  return c % cw < cw - 1 ? c + 1 : -1;
+   case 2:  return c < (ch - 1) * cw ? c + cw : -1;
+   default: return c % cw > 0 ? c - 1 : -1;
+   }
+}
+
+#define MAZE_EVEN_BITS 0x5555555555555555UL // squares on even columns
+
+static inline void open_cell(maze_map *m, int c, int cw)
+{
+   maze_clear_wall(m, 2 * (c % cw), 2 * (c / cw));
+}
+
+/* Knock down the wall between two neighbouring cells: the square halfway */
+static inline void open_wall(maze_map *m, int a, int b, int cw)
+{
+   maze_clear_wall(m, a % cw + b % cw, a / cw + b / cw);
+}
+
+/* Fill the grid with walls and clear the bitsets; returns the cell count, 0 when out of memory */
+static int maze_begin(maze_map *m, int *cw, int *ch)
+{
+   *cw = (m->width + 1) / 2;
+   *ch = (m->height + 1) / 2;
+   int cells = *cw * *ch;
+
+   if (m->width < 1 || m->height < 1 || !maze_scratch(cells)) {
+      LOG("maze: no room for %d cells", cells);
+      return 0;
+   }
+   for (int i = 0; i < m->height * m->words; i++) {
+      m->bits[i] = ~0UL;
+   }
+   for (int i = 0; i < (cells + 63) / 64; i++) {
+      in_maze[i] = 0;
+      in_frontier[i] = 0;
+   }
+   return cells;
+}
+
+/* Put the destination on a random cell */
+static void maze_end(maze_map *m, int cw, int ch)
+{
+   int c = rand_range(0, cw * ch - 1);
+   m->goal = 2 * (c / cw) * m->width + 2 * (c % cw);
+   LOG("maze: %d x %d cells", cw, ch);
+}
+
+/*
+* Randomized Prim. The frontier holds each cell at most once
+* (in_frontier) and a random entry is taken out by swapping in the last
+* one, so every cell is handled once: O(cells) time. Each cell joins the
+* maze through exactly one opening, which makes the maze perfect over the
+* whole grid (one path between any two cells).
+* Returns 0 when the scratch space does not fit.
+*/
+int GenerateMaze(maze_map *m) {
+   PROF_SCOPE("maze_generate");
+   int cw, ch;
+   int cells = maze_begin(m, &cw, &ch);
+   unsigned int *frontier = work;   // cells next to the maze, not in it yet
+   int n = 0;
+
+   if (cells == 0)
+      return 0;
+
+   int c = rand_range(0, cells - 1);
+   while (1) {
+      open_cell(m, c, cw);
+      BIT_SET(in_maze, c);
+
+      // CHECK FOR NORTH, EAST, SOUTH AND WEST FRONTIER
+      for (int d = 0; d < 4; d++) {
+         int next = cell_step(c, d, cw, ch);
+         if (next >= 0 && !BIT_TEST(in_maze, next) && !BIT_TEST(in_frontier, next)) {
+            BIT_SET(in_frontier, next);
+            frontier[n++] = next;
+         }
       }
+      if (n == 0)
+         break;
+
+      // take a random frontier cell out
+      int k = rand_range(0, n - 1);
+      c = frontier[k];
+      frontier[k] = frontier[--n];
+
+      // and open the wall to one of its neighbours already in the maze
+      int joined[4], j = 0;
+      for (int d = 0; d < 4; d++) {
+         int next = cell_step(c, d, cw, ch);
+         if (next >= 0 && BIT_TEST(in_maze, next))
+            joined[j++] = next;
+      }
+      open_wall(m, c, joined[rand_range(0, j - 1)], cw);
    }
 
+   maze_end(m, cw, ch);
+   return 1;
 }
 
-void GenerateMaze(char *maze, int width, int height) {
-   int x,y, dir;
-   int frontier = 0;
-   int frontierParsed = 0;
-   int *xDirArrays = (int*)selfmalloc(width * height * sizeof(int));
-   int *yDirArrays = (int*)selfmalloc(width * height * sizeof(int));
-   for (x = 0; x < width * height; x++) {
-      maze[x] = 1;
+/*
+* Recursive backtracker without recursion: walk to a random unvisited
+* neighbour, and when there is none go back along an explicit stack (at
+* most one entry per cell). Gives long, winding corridors with few dead ends.
+*/
+int GenerateMazeBacktrack(maze_map *m) {
+   PROF_SCOPE("maze_backtrack");
+   int cw, ch;
+   int cells = maze_begin(m, &cw, &ch);
+   unsigned int *stack = work;
+   int top = 0;
+
+   if (cells == 0)
+      return 0;
+
+   int c = rand_range(0, cells - 1);
+   open_cell(m, c, cw);
+   BIT_SET(in_maze, c);
+   stack[top++] = c;
+   while (top > 0) {
+      c = stack[top - 1];
+      int next[4], j = 0;
+      for (int d = 0; d < 4; d++) {
+         int n = cell_step(c, d, cw, ch);
+         if (n >= 0 && !BIT_TEST(in_maze, n))
+            next[j++] = n;
+      }
+      if (j == 0) {
+         top--;
+         continue;
+      }
+      int n = next[rand_range(0, j - 1)];
+      open_wall(m, c, n, cw);
+      open_cell(m, n, cw);
+      BIT_SET(in_maze, n);
+      stack[top++] = n;
    }
 
-   int randomX = rand_range(0, width);
-   int randomY = rand_range(0, height);
-   x = randomX;
-   y = randomY;
+   maze_end(m, cw, ch);
+   return 1;
+}
+
+/*
+* Wilson: from each cell not in the maze yet, random walk until the maze
+* is hit, remembering only the last way out of every cell (which erases
+* the loops), then add that path. Every perfect maze is equally likely;
+* the first walks are long, so it is the slowest generator here.
+*/
+int GenerateMazeWilson(maze_map *m) {
+   PROF_SCOPE("maze_wilson");
+   int cw, ch;
+   int cells = maze_begin(m, &cw, &ch);
+   unsigned char *way = (unsigned char*)work;   // direction of the last step out of each cell
+
+   if (cells == 0)
+      return 0;
 
-   maze[randomY * width + randomX] = 0;
-   // CHECK FOR NORTH FRONTIER
-   if (y *width + x - 2*width > 0) {
-      *(xDirArrays + frontier) = x;
-      *(yDirArrays + frontier) = y - 2;
-      frontier++;
+   int root = rand_range(0, cells - 1);
+   open_cell(m, root, cw);
+   BIT_SET(in_maze, root);
+   for (int s = 0; s < cells; s++) {
+      int c = s;
+      while (!BIT_TEST(in_maze, c)) {
+         int d, n;
+         do {
+            d = rand_range(0, 3);
+            n = cell_step(c, d, cw, ch);
+         } while (n < 0);
+         way[c] = d;
+         c = n;
+      }
+      for (c = s; !BIT_TEST(in_maze, c); ) {
+         int n = cell_step(c, way[c], cw, ch);
+         open_cell(m, c, cw);
+         BIT_SET(in_maze, c);
+         open_wall(m, c, n, cw);
+         c = n;
+      }
    }
-   //CHECK FOR EAST FRONTIER
-   if (y*width + x + 2 < (y + 1) * width){
-      *(xDirArrays + frontier) = x + 2;
-      *(yDirArrays + frontier) = y;
-      frontier++;
+
+   maze_end(m, cw, ch);
+   return 1;
+}
+
+/* Root of cell c in the Kruskal forest, halving the path on the way */
+static unsigned int forest_root(unsigned int *parent, unsigned int c)
+{
+   while (parent[c] != c) {
+      parent[c] = parent[parent[c]];
+      c = parent[c];
+   }
+   return c;
+}
+
+/*
+* Kruskal: take the walls between cells in random order and knock one down
+* when the cells on either side are not connected yet (union-find with
+* path halving). Edge e joins cell e / 2 to its east (e even) or south
+* (e odd) neighbour.
+*/
+int GenerateMazeKruskal(maze_map *m) {
+   PROF_SCOPE("maze_kruskal");
+   int cw, ch;
+   int cells = maze_begin(m, &cw, &ch);
+   unsigned int *parent = work, *edges = work + cells;
+   int n = 0;
+
+   if (cells == 0)
+      return 0;
+
+   // every cell is open from the start: clear the even bits of the even rows
+   for (int y = 0; y < m->height; y += 2) {
+      uint64_t *row = maze_row(m, y);
+      for (int i = 0; i < m->words; i++) {
+         row[i] &= ~(MAZE_EVEN_BITS & maze_word_mask(m->width, i));
+      }
    }
-   //CHECK FOR SOUTH FRONTIER
-   if (y* width + x + 2 *width < width * height) {
-      *(xDirArrays + frontier) = x;
-      *(yDirArrays + frontier) = y + 2;
-      frontier++;
+   for (int c = 0; c < cells; c++) {
+      parent[c] = c;
+      if (cell_step(c, 1, cw, ch) >= 0)
+         edges[n++] = 2 * c;
+      if (cell_step(c, 2, cw, ch) >= 0)
+         edges[n++] = 2 * c + 1;
    }
-   //CHECK FOR WEST FRONTIER
-   if (y*width + x - 2 > y * width - 1) {
-      *(xDirArrays + frontier) = x - 2;
-      *(yDirArrays + frontier) = y;
-      frontier++;
+   for (; n > 0; n--) {
+      int k = rand_range(0, n - 1);
+      unsigned int e = edges[k];
+      edges[k] = edges[n - 1];
+      unsigned int a = e / 2, b = e & 1 ? a + cw : a + 1;
+      unsigned int ra = forest_root(parent, a), rb = forest_root(parent, b);
+      if (ra != rb) {
+         parent[ra] = rb;
+         open_wall(m, a, b, cw);
+      }
    }
-   for (int i = 0; i < 199; i++) {
-   while (1) {
-         dir = rand_range(0, frontier - 1);
-         if (   maze[*(yDirArrays + dir)*width + *(xDirArrays + dir)] == 0) {
-            continue;
+
+   maze_end(m, cw, ch);
+   return 1;
+}
+
+/* Scratch space of Eller, a few words per column: grows only for a wider maze */
+static int *eller_set, *eller_first, *eller_count, *eller_went, *eller_below;
+static uint64_t *eller_row;
+static int eller_width = 0;
+
+static int eller_scratch(int width)
+{
+   if (width <= eller_width)
+      return 1;
+   int cw = (width + 1) / 2;
+   int *a = (int*)selfmalloc(5UL * cw * sizeof(int));
+   uint64_t *row = (uint64_t*)selfmalloc(MAZE_ROW_WORDS(width) * sizeof(uint64_t));
+   if (a == NULL || row == NULL)
+      return 0;
+   eller_set = a;
+   eller_first = a + cw;
+   eller_count = a + 2 * cw;
+   eller_went = a + 3 * cw;
+   eller_below = a + 4 * cw;
+   eller_row = row;
+   eller_width = width;
+   return 1;
+}
+
+static int eller_root(int *set, int x)
+{
+   while (set[x] != x) {
+      set[x] = set[set[x]];
+      x = set[x];
+   }
+   return x;
+}
+
+/*
+* Eller: build the maze one row of cells at a time, keeping only which
+* cells of the current row are connected (union-find over the columns).
+* Neighbouring cells of different sets are joined at random, then every
+* set goes on at least once through the floor; the last row joins all the
+* sets left. Memory is O(width) whatever the height.
+*
+* Each grid row (packed as in maze_map) is passed to emit as soon as it is
+* done; emit returns nonzero to stop early.
+* Returns 0 when out of memory.
+*/
+int StreamMazeEller(int width, unsigned long height, maze_row_fn emit, void *ctx) {
+   PROF_SCOPE("maze_eller");
+   int cw = (width + 1) / 2;
+   unsigned long ch = (height + 1) / 2;
+   int words = MAZE_ROW_WORDS(width);
+   int *set, *first, *count, *went, *below;
+   uint64_t *row;
+
+   if (width < 1 || height < 1 || !eller_scratch(width)) {
+      LOG("maze: no room for a row of %d", width);
+      return 0;
+   }
+   set = eller_set;
+   first = eller_first;
+   count = eller_count;
+   went = eller_went;
+   below = eller_below;
+   row = eller_row;
+
+   unsigned long goal_y = xorshift32() % ch;
+   int goal_x = rand_range(0, cw - 1);
+   for (int x = 0; x < cw; x++) {
+      below[x] = -1;
+      first[x] = -1;
+   }
+
+   for (unsigned long cy = 0; cy < ch; cy++) {
+      int last = cy == ch - 1;
+
+      // cells reached from above stay in the set they came from
+      for (int x = 0; x < cw; x++) {
+         set[x] = x;
+         if (below[x] >= 0) {
+            if (first[below[x]] < 0)
+               first[below[x]] = x;
+            set[x] = first[below[x]];
          }
-         maze[*(yDirArrays + dir)*width + *(xDirArrays + dir)] = 0;
-         frontierParsed++;
-         break;
       }
-      // CASE FRONTIER WAS TOP
-      if (maze[(*(yDirArrays + dir) + 2)*width + *(xDirArrays + dir)] == 0 && (*(yDirArrays + dir))*width + *(xDirArrays + dir) > 0 && (*(yDirArrays + dir) + 2)*width + *(xDirArrays + dir) < width * height) {
-         maze[(*(yDirArrays + dir) + 1)*width + *(xDirArrays + dir)] = 0;
-      }
-      // CASE FRONTIER WAS EAST
-      else if (maze[*(yDirArrays + dir)*width + *(xDirArrays + dir) - 2] == 0 && (*(yDirArrays + dir)*width + *(xDirArrays + dir)) < (*(yDirArrays + dir)*width + width) && (*(yDirArrays + dir)*width + *(xDirArrays + dir) - 2) >= (*(yDirArrays + dir)*width)) {
-         maze[*(yDirArrays + dir)*width + *(xDirArrays + dir) - 1] = 0;
-      }
-      // CASE FRONTIER WAS SOUTH
-      else if (maze[(*(yDirArrays + dir) - 2)*width + *(xDirArrays + dir)] == 0 && (*(yDirArrays + dir))*width + *(xDirArrays + dir) < width * height && (*(yDirArrays + dir) - 2)*width + *(xDirArrays + dir) > 0) {
-         maze[(*(yDirArrays + dir) - 1)*width + *(xDirArrays + dir)] = 0;
-      }
-      else if (maze[*(yDirArrays + dir)*width + *(xDirArrays + dir) + 2] == 0 && (*(yDirArrays + dir)*width + *(xDirArrays + dir)) >(*(yDirArrays + dir)*width) - 1) {
-         maze[*(yDirArrays + dir)*width + *(xDirArrays + dir) + 1] = 0;
-      }
-      x = *(xDirArrays + dir);
-      y = *(yDirArrays + dir);
-      // CHECK FOR NORTH FRONTIER
-      if (y *width + x - 2*width > 0 && maze[y *width + x - 2*width] != 0) {
-         *(xDirArrays + frontier) = x;
-         *(yDirArrays + frontier) = y - 2;
-         frontier++;
-      }
-      //CHECK FOR EAST FRONTIER
-      if (y*width + x + 2 < (y + 1) * width && maze[y*width + x + 2] != 0){
-         *(xDirArrays + frontier) = x + 2;
-         *(yDirArrays + frontier) = y;
-         frontier++;
-      }
-      //CHECK FOR SOUTH FRONTIER
-      if (y* width + x + 2 *width < width * height && maze[y* width + x + 2 *width] != 0) {
-         *(xDirArrays + frontier) = x;
-         *(yDirArrays + frontier) = y + 2;
-         frontier++;
-      }
-      //CHECK FOR WEST FRONTIER
-      if (y*width + x - 2 > y * width - 1 && maze[y*width + x - 2] != 0) {
-         *(xDirArrays + frontier) = x - 2;
-         *(yDirArrays + frontier) = y;
-         frontier++;
-      }
-   }
-
-   // while (1) {
-   //       dir = rand_range(0, frontier - 1);
-   //       if (   maze[*(yDirArrays + dir)*width + *(xDirArrays + dir)] == 0) {
-   //          maze[*(yDirArrays + dir)*width + *(xDirArrays + dir)] = 2;
-   //          break;
-   //       }
-   //    }
-   while (1) {
-      dir = rand_range(0, width * height);
-      if (   maze[dir] == 0) {
-         maze[dir] = 2;
+      for (int x = 0; x < cw; x++) {
+         if (below[x] >= 0)
+            first[below[x]] = -1;
+      }
+
+      // join neighbours of different sets
+      for (int i = 0; i < words; i++) {
+         row[i] = ~(MAZE_EVEN_BITS & maze_word_mask(width, i));
+      }
+      for (int x = 0; x + 1 < cw; x++) {
+         int a = eller_root(set, x), b = eller_root(set, x + 1);
+         if (a != b && (last || rand_range(0, 1))) {
+            set[a] = b;
+            BIT_CLEAR(row, 2 * x + 1);
+         }
+      }
+      if (emit(row, width, cy == goal_y ? 2 * goal_x : -1, ctx))
+         return 1;
+      if (2 * cy + 1 >= height)
          break;
+
+      // go down from every set at least once
+      for (int x = 0; x < cw; x++) {
+         set[x] = eller_root(set, x);
+         count[x] = 0;
+         went[x] = 0;
+      }
+      for (int x = 0; x < cw; x++) {
+         count[set[x]]++;
       }
+      for (int i = 0; i < words; i++) {
+         row[i] = ~0UL;
+      }
+      for (int x = 0; x < cw; x++) {
+         int r = set[x];
+         count[r]--; // cells of the set still to come
+         int down = !last && (rand_range(0, 1) || (count[r] == 0 && !went[r]));
+         if (down) {
+            went[r] = 1;
+            BIT_CLEAR(row, 2 * x);
+         }
+         below[x] = down ? r : -1;
+      }
+      if (emit(row, width, -1, ctx))
+         return 1;
    }
+   return 1;
+}
+
+/* Eller into a whole maze: each row is copied into place */
+typedef struct {
+   maze_map *m;
+   int y;
+} eller_copy;
 
-   printf("This is amount of frontier: %d\n", frontier - frontierParsed);
-   // for (int i = 0; i < frontier; i++) {
-   //    maze[*(yDirArrays + i)*width + *(xDirArrays + i)] = 0;
-   // }
-}
\ No newline at end of file
+static int eller_store(const uint64_t *row, int width, int goal, void *ctx)
+{
+   eller_copy *dst = (eller_copy*)ctx;
+   uint64_t *out = maze_row(dst->m, dst->y);
+   for (int i = 0; i < dst->m->words; i++) {
+      out[i] = row[i];
+   }
+   if (goal >= 0)
+      dst->m->goal = dst->y * width + goal;
+   dst->y++;
+   return 0;
+}
+
+int GenerateMazeEller(maze_map *m) {
+   eller_copy dst = { m, 0 };
+   return StreamMazeEller(m->width, m->height, eller_store, &dst);
+}
+
+/* Send a streamed row; a key press stops */
+static int show_row(const uint64_t *row, int width, int goal, void *ctx)
+{
+   send_row(row, width, goal);
+   return uart_rx_ready();
+}
+
+/* Display a maze of any height, generated with Eller while it is sent */
+int ShowMazeStream(int width, unsigned long height) {
+   int ok = StreamMazeEller(width, height, show_row, NULL);
+   if (ok && uart_rx_ready())
+      uart_getc();
+   return ok;
+}
+
+const maze_generator maze_generators[] = {
+   { "prim",      GenerateMaze,          "randomized Prim, short branches (default)" },
+   { "backtrack", GenerateMazeBacktrack, "recursive backtracker, long winding corridors" },
+   { "wilson",    GenerateMazeWilson,    "loop-erased random walks, every maze equally likely" },
+   { "kruskal",   GenerateMazeKruskal,   "random walls joined with union-find" },
+   { "eller",     GenerateMazeEller,     "row by row in O(width) memory" },
+};
+const int maze_generator_count = sizeof(maze_generators) / sizeof(maze_generators[0]);
+
+/* The generator called name, NULL when there is none */
+const maze_generator *FindMazeGenerator(const char *name) {
+   for (int i = 0; i < maze_generator_count; i++)
+      if (strcmp(maze_generators[i].name, name) == 0)
+         return &maze_generators[i];
+   return NULL;
+}
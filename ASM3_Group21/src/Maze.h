@@ -1,14 +1,126 @@
+#ifndef MAZE_H
+#define MAZE_H
+
 #include "../gcclib/stddef.h"
 #include "../gcclib/stdint.h"
 #include "../gcclib/stdarg.h"
 
+/*
+* A maze is a grid of width x height squares held one bit per square
+* (1 wall, 0 path), row by row in 64-bit words: a whole row of up to 64
+* squares is one machine word. Bits past the width are walls too, so rows
+* can be handled a word at a time. The destination is kept apart, as a
+* square number.
+*
+* Cells sit on even coordinates with walls between them, and every
+* generator makes a perfect maze (one path between any two cells); they
+* differ in the shape of the corridors and in speed.
+*/
+typedef struct {
+    int width, height;
+    int words;          // 64-bit words per row
+    int goal;           // destination square, y * width + x
+    uint64_t *bits;     // height * words, 8-byte aligned
+} maze_map;
+
+#define MAZE_ROW_WORDS(width) (((width) + 63) / 64)
+#define MAZE_BYTES(width, height) ((size_t)MAZE_ROW_WORDS(width) * (height) * sizeof(uint64_t))
+
+/* Squares of a grid row, as returned by maze_square() */
+#define MAZE_PATH 0
+#define MAZE_WALL 1
+#define MAZE_GOAL 2
+
+static inline void maze_map_init(maze_map *m, uint64_t *bits, int width, int height)
+{
+    m->width = width;
+    m->height = height;
+    m->words = MAZE_ROW_WORDS(width);
+    m->goal = -1;
+    m->bits = bits;
+}
+
+static inline uint64_t *maze_row(const maze_map *m, int y)
+{
+    return m->bits + (size_t)y * m->words;
+}
+
+/* Bits of word i of a row that are squares of the maze, not padding */
+static inline uint64_t maze_word_mask(int width, int i)
+{
+    int left = width - 64 * i;
+    return left >= 64 ? ~0UL : (1UL << left) - 1;
+}
+
+/* Open squares of word i of row y, one bit each */
+static inline uint64_t maze_open_word(const maze_map *m, int y, int i)
+{
+    return ~maze_row(m, y)[i] & maze_word_mask(m->width, i);
+}
+
+/* Wall test; outside the grid counts as wall */
+static inline int maze_wall(const maze_map *m, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= m->width || y >= m->height)
+        return 1;
+    return (maze_row(m, y)[x >> 6] >> (x & 63)) & 1;
+}
+
+static inline void maze_set_wall(maze_map *m, int x, int y)
+{
+    maze_row(m, y)[x >> 6] |= 1UL << (x & 63);
+}
+
+static inline void maze_clear_wall(maze_map *m, int x, int y)
+{
+    maze_row(m, y)[x >> 6] &= ~(1UL << (x & 63));
+}
+
+/* MAZE_PATH, MAZE_WALL or MAZE_GOAL */
+static inline int maze_square(const maze_map *m, int x, int y)
+{
+    if (maze_wall(m, x, y))
+        return MAZE_WALL;
+    return y * m->width + x == m->goal ? MAZE_GOAL : MAZE_PATH;
+}
+
+/* Fills m (storage, width and height set by maze_map_init); 0 when out of memory */
+typedef int (*maze_generate_fn)(maze_map *m);
+
+typedef struct {
+    const char *name;
+    maze_generate_fn generate;
+    const char *summary;
+} maze_generator;
+
+/* Receives each grid row of a streamed maze (goal: destination column
+   in this row, -1 for none); nonzero stops the stream */
+typedef int (*maze_row_fn)(const uint64_t *row, int width, int goal, void *ctx);
+
+#define MAZE_STREAM_MAX_WIDTH 2000 //widest maze the maze command streams
+
+extern const maze_generator maze_generators[];
+extern const int maze_generator_count;
+
 /* Display the maze. */
-void ShowMaze(const char *maze, int width, int height);
+void ShowMaze(const maze_map *m);
+
+/* Display a maze of any height, generated row by row while it is sent (0 when out of memory). */
+int ShowMazeStream(int width, unsigned long height);
+
+/* Generate the maze m (0 when out of memory). */
+int GenerateMaze(maze_map *m);
+int GenerateMazeBacktrack(maze_map *m);
+int GenerateMazeWilson(maze_map *m);
+int GenerateMazeKruskal(maze_map *m);
+int GenerateMazeEller(maze_map *m);
+
+/* Generate with Eller and pass the rows to emit, in O(width) memory (0 when out of memory). */
+int StreamMazeEller(int width, unsigned long height, maze_row_fn emit, void *ctx);
 
-/*  Carve the maze starting at x, y. */
-void CarveMaze(char *maze, int width, int height, int x, int y);
+/* The generator called name, NULL when there is none */
+const maze_generator *FindMazeGenerator(const char *name);
 
-/* Generate maze in matrix maze with size width, height. */
-void GenerateMaze(char *maze, int width, int height);
+int rand_range(int min, int max);
 
-int rand_range(int min, int max);
\ No newline at end of file
+#endif
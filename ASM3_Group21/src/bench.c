@@ -0,0 +1,512 @@
+// -----------------------------------bench.c -------------------------------------
+#include "bench.h"
+#include "printf.h"
+#include "numfmt.h"
+#include "clock.h"
+#include "framebf.h"
+#include "mbox.h"
+#include "Maze.h"
+#include "path.h"
+#include "../uart/uart.h"
+
+volatile unsigned long bench_sink;
+unsigned long bench_work;
+
+/* main.c */
+void *memset(void *ptr, int value, size_t num);
+void *memcpy(void *dest, const void *src, size_t num);
+
+/* ----------------------------- number formatting ----------------------------- */
+
+/* Values spread over all digit counts */
+static unsigned long bench_value(unsigned int i)
+{
+    return (0x9E3779B97F4A7C15UL * (i + 1)) >> (i & 63);
+}
+
+/* The conversion uart_dec used before numfmt: count digits, then divide per digit */
+static int legacy_dec(char *str, int num)
+{
+    int len = 1;
+    int temp = num;
+    while (temp >= 10) {
+        len++;
+        temp = temp / 10;
+    }
+    for (int i = 0; i < len; i++) {
+        str[len - (i + 1)] = num % 10 + '0';
+        num = num / 10;
+    }
+    return len;
+}
+
+static void bench_dec_legacy(unsigned int iters)
+{
+    char str[33];
+    for (unsigned int i = 0; i < iters; i++)
+        bench_sink += legacy_dec(str, (int)(bench_value(i) & 0x7FFFFFFF));
+}
+
+static void bench_dec_numfmt32(unsigned int iters)
+{
+    char str[NUMFMT_MAX_CHARS];
+    for (unsigned int i = 0; i < iters; i++)
+        bench_sink += *fmt_u64_dec(str + sizeof(str), bench_value(i) & 0x7FFFFFFF);
+}
+
+static void bench_dec_numfmt64(unsigned int iters)
+{
+    char str[NUMFMT_MAX_CHARS];
+    for (unsigned int i = 0; i < iters; i++)
+        bench_sink += *fmt_u64_dec(str + sizeof(str), bench_value(i));
+}
+
+/* The nibble loop printf used for %x before numfmt */
+static void bench_hex_legacy(unsigned int iters)
+{
+    char str[16];
+    for (unsigned int i = 0; i < iters; i++) {
+        unsigned int x = (unsigned int)bench_value(i);
+        int n = 16;
+        do {
+            int remainder = x % 16;
+            str[--n] = (remainder < 10) ? (remainder + '0') : (remainder - 10 + 'a');
+            x /= 16;
+        } while (x != 0);
+        bench_sink += str[n];
+    }
+}
+
+static void bench_hex_numfmt(unsigned int iters)
+{
+    char str[16];
+    for (unsigned int i = 0; i < iters; i++)
+        bench_sink += *fmt_u64_hex(str + sizeof(str), (unsigned int)bench_value(i), 0, 1);
+}
+
+static void bench_snprintf(unsigned int iters)
+{
+    char str[64];
+    for (unsigned int i = 0; i < iters; i++)
+        bench_sink += snprintf(str, sizeof(str), "%d %x %lu", (int)i, i, bench_value(i));
+}
+
+/* ----------------------------- floating point ----------------------------- */
+
+/* Telemetry-like values: frame times, rates, temperatures */
+static double bench_double(unsigned int i)
+{
+    return (double)(bench_value(i) & 0xFFFFF) / 64.0;
+}
+
+/* The %f conversion printf used before fmt_double_fixed: int cast and x10 loop */
+static void bench_float_legacy(unsigned int iters)
+{
+    char str[NUMFMT_MAX_CHARS + 8];
+    for (unsigned int i = 0; i < iters; i++) {
+        double value = bench_double(i);
+        int int_part = (int)value;
+        double fractional_part = value - int_part;
+        char *p = fmt_u64_dec(str + NUMFMT_MAX_CHARS, int_part);
+        for (int d = 0; d < 6; d++) {
+            fractional_part *= 10;
+            int digit = (int)fractional_part;
+            str[NUMFMT_MAX_CHARS + d] = digit + '0';
+            fractional_part -= digit;
+        }
+        bench_sink += *p + str[NUMFMT_MAX_CHARS + 5];
+    }
+}
+
+static void bench_float_exact(unsigned int iters)
+{
+    char str[NUMFMT_DOUBLE_CHARS];
+    int negative;
+    for (unsigned int i = 0; i < iters; i++)
+        bench_sink += fmt_double_fixed(str, bench_double(i), 6, &negative);
+}
+
+static void bench_float_exact_large(unsigned int iters)
+{
+    char str[NUMFMT_DOUBLE_CHARS];
+    int negative;
+    for (unsigned int i = 0; i < iters; i++)
+        bench_sink += fmt_double_fixed(str, bench_double(i) * 1e200, 6, &negative);
+}
+
+/* ----------------------------------- memory ----------------------------------- */
+
+#define BENCH_MEM_SIZE (64 * 1024)
+
+static unsigned char bench_src[BENCH_MEM_SIZE] __attribute__((aligned(16)));
+static unsigned char bench_dst[BENCH_MEM_SIZE] __attribute__((aligned(16)));
+
+static void bench_memset(unsigned int iters)
+{
+    for (unsigned int i = 0; i < iters; i++)
+        memset(bench_dst, i, BENCH_MEM_SIZE);
+    bench_sink += bench_dst[BENCH_MEM_SIZE - 1];
+}
+
+static void bench_memcpy(unsigned int iters)
+{
+    for (unsigned int i = 0; i < iters; i++) {
+        bench_src[i & (BENCH_MEM_SIZE - 1)] = i;
+        memcpy(bench_dst, bench_src, BENCH_MEM_SIZE);
+    }
+    bench_sink += bench_dst[BENCH_MEM_SIZE - 1];
+}
+
+/* ------------------------------- drivers and maze ------------------------------- */
+
+/* A 64x64 block in the bottom right corner of the screen, one pixel at a time */
+static void bench_pixel_fill(unsigned int iters)
+{
+    int x0 = width - 64, y0 = height - 64;
+    for (unsigned int i = 0; i < iters; i++)
+        for (int y = 0; y < 64; y++)
+            for (int x = 0; x < 64; x++)
+                drawPixelARGB32(x0 + x, y0 + y, 0x00102030 + i);
+}
+
+/* A line of blanks and a carriage return: the text on screen stays put */
+static void bench_uart(unsigned int iters)
+{
+    char line[64];
+    for (int i = 0; i < 63; i++)
+        line[i] = ' ';
+    line[63] = '\r';
+    for (unsigned int i = 0; i < iters; i++)
+        uart_write(line, sizeof(line));
+    uart_flush();
+}
+
+/* One property message (firmware revision) sent and answered */
+static void bench_mbox(unsigned int iters)
+{
+    for (unsigned int i = 0; i < iters; i++) {
+        mbox_msg m;
+        mbox_msg_init(&m, mBuf, MBOX_BUF_WORDS);
+        volatile mbox_value *fw = mbox_get_firmware(&m);
+        if (mbox_msg_send(&m))
+            bench_sink += fw->value;
+    }
+}
+
+/* Grids up to 2000x2000 squares (500 KB bit-packed): the time per cell should stay flat */
+static uint64_t bench_maze_bits[MAZE_ROW_WORDS(2000) * 2000];
+
+/* Cells of a width x height grid: they sit on even coordinates, walls between */
+#define BENCH_CELLS(width, height) (((width) + 1) / 2 * (((height) + 1) / 2))
+
+static void bench_generate(maze_generate_fn gen, int width, int height, unsigned int iters)
+{
+    maze_map m;
+
+    maze_map_init(&m, bench_maze_bits, width, height);
+    for (unsigned int i = 0; i < iters; i++)
+        bench_sink += gen(&m);
+}
+
+static void bench_maze_40x20(unsigned int iters)
+{
+    bench_generate(GenerateMaze, 40, 20, iters);
+}
+
+static void bench_maze_200x200(unsigned int iters)
+{
+    bench_generate(GenerateMaze, 200, 200, iters);
+}
+
+static void bench_maze_632x632(unsigned int iters)
+{
+    bench_generate(GenerateMaze, 632, 632, iters);
+}
+
+static void bench_maze_2000x2000(unsigned int iters)
+{
+    bench_generate(GenerateMaze, 2000, 2000, iters);
+}
+
+/* Every generator on the same maze, to compare cells/s */
+#define BENCH_GENERATOR(fn, gen) \
+    static void fn(unsigned int iters) \
+    { \
+        bench_generate(gen, 200, 200, iters); \
+    }
+
+BENCH_GENERATOR(bench_gen_prim, GenerateMaze)
+BENCH_GENERATOR(bench_gen_backtrack, GenerateMazeBacktrack)
+BENCH_GENERATOR(bench_gen_wilson, GenerateMazeWilson)
+BENCH_GENERATOR(bench_gen_kruskal, GenerateMazeKruskal)
+BENCH_GENERATOR(bench_gen_eller, GenerateMazeEller)
+
+static int bench_row_sink(const uint64_t *row, int width, int goal, void *ctx)
+{
+    bench_sink += row[0];
+    return 0;
+}
+
+/* Eller without a maze buffer: 2000 squares wide, 2000 rows */
+static void bench_gen_eller_stream(unsigned int iters)
+{
+    for (unsigned int i = 0; i < iters; i++)
+        bench_sink += StreamMazeEller(2000, 2000, bench_row_sink, 0);
+}
+
+/* Corner to corner on a fixed maze, generated on first use */
+static uint64_t bench_path_bits[MAZE_ROW_WORDS(1001) * 1001];
+static maze_map bench_path_maze;
+
+typedef int (*bench_solver)(const maze_map *m, int start, int goal, int *path, int max, path_result *r);
+
+static void bench_path_setup(int size)
+{
+    if (bench_path_maze.width != size) {
+        maze_map_init(&bench_path_maze, bench_path_bits, size, size);
+        GenerateMaze(&bench_path_maze);
+    }
+}
+
+static void bench_solve(bench_solver solve, int size, unsigned int iters)
+{
+    path_result r;
+
+    bench_path_setup(size);
+    for (unsigned int i = 0; i < iters; i++)
+        bench_sink += solve(&bench_path_maze, 0, size * size - 1, 0, 0, &r);
+    bench_work = r.expanded;
+}
+
+static void bench_astar_41(unsigned int iters)
+{
+    bench_solve(path_astar, 41, iters);
+}
+
+static void bench_jps_41(unsigned int iters)
+{
+    bench_solve(path_jps, 41, iters);
+}
+
+static void bench_astar_1001(unsigned int iters)
+{
+    bench_solve(path_astar, 1001, iters);
+}
+
+static void bench_jps_1001(unsigned int iters)
+{
+    bench_solve(path_jps, 1001, iters);
+}
+
+/* Distances from the far corner to every square of the same mazes */
+static unsigned int bench_dist[1001 * 1001];
+
+typedef int (*bench_field)(const maze_map *m, int target, unsigned int *dist);
+
+static void bench_distances(bench_field field, int size, unsigned int iters)
+{
+    int reached = 0;
+
+    bench_path_setup(size);
+    for (unsigned int i = 0; i < iters; i++)
+        reached = field(&bench_path_maze, size * size - 1, bench_dist);
+    bench_sink += reached;
+    bench_work = reached;
+}
+
+static void bench_dist_queue_41(unsigned int iters)
+{
+    bench_distances(path_distances_queue, 41, iters);
+}
+
+static void bench_dist_bits_41(unsigned int iters)
+{
+    bench_distances(path_distances, 41, iters);
+}
+
+static void bench_dist_queue_1001(unsigned int iters)
+{
+    bench_distances(path_distances_queue, 1001, iters);
+}
+
+static void bench_dist_bits_1001(unsigned int iters)
+{
+    bench_distances(path_distances, 1001, iters);
+}
+
+static const bench_case cases[] = {
+    {"dec_legacy",   bench_dec_legacy,   100000, 0, NULL},
+    {"dec_numfmt32", bench_dec_numfmt32, 100000, 0, NULL},
+    {"dec_numfmt64", bench_dec_numfmt64, 100000, 0, NULL},
+    {"hex_legacy",   bench_hex_legacy,   100000, 0, NULL},
+    {"hex_numfmt",   bench_hex_numfmt,   100000, 0, NULL},
+    {"snprintf",     bench_snprintf,     20000, 1, "call"},
+    {"float_legacy", bench_float_legacy, 50000, 0, NULL},
+    {"float_exact",  bench_float_exact,  50000, 0, NULL},
+    {"float_exact_large", bench_float_exact_large, 2000, 0, NULL},
+    {"memset",       bench_memset,       4, BENCH_MEM_SIZE, "B"},
+    {"memcpy",       bench_memcpy,       4, BENCH_MEM_SIZE, "B"},
+    {"pixel_fill",   bench_pixel_fill,   4, 64 * 64, "px"},
+    {"uart",         bench_uart,         16, 64, "B"},
+    {"mbox",         bench_mbox,         20, 1, "msg"},
+    {"maze_40x20",   bench_maze_40x20,   100, BENCH_CELLS(40, 20), "cells"},
+    {"maze_200x200", bench_maze_200x200, 4, BENCH_CELLS(200, 200), "cells"},
+    {"maze_632x632", bench_maze_632x632, 1, BENCH_CELLS(632, 632), "cells"},
+    {"maze_2000x2000", bench_maze_2000x2000, 1, BENCH_CELLS(2000, 2000), "cells"},
+    {"gen_prim",      bench_gen_prim,      4, BENCH_CELLS(200, 200), "cells"},
+    {"gen_backtrack", bench_gen_backtrack, 4, BENCH_CELLS(200, 200), "cells"},
+    {"gen_wilson",    bench_gen_wilson,    4, BENCH_CELLS(200, 200), "cells"},
+    {"gen_kruskal",   bench_gen_kruskal,   4, BENCH_CELLS(200, 200), "cells"},
+    {"gen_eller",     bench_gen_eller,     4, BENCH_CELLS(200, 200), "cells"},
+    {"gen_eller_stream", bench_gen_eller_stream, 1, BENCH_CELLS(2000, 2000), "cells"},
+    {"path_astar_41",   bench_astar_41,   20, 1, "nodes"},
+    {"path_jps_41",     bench_jps_41,     20, 1, "nodes"},
+    {"path_astar_1001", bench_astar_1001, 1, 1, "nodes"},
+    {"path_jps_1001",   bench_jps_1001,   1, 1, "nodes"},
+    {"dist_queue_41",   bench_dist_queue_41,   20, 1, "squares"},
+    {"dist_bits_41",    bench_dist_bits_41,    20, 1, "squares"},
+    {"dist_queue_1001", bench_dist_queue_1001, 1, 1, "squares"},
+    {"dist_bits_1001",  bench_dist_bits_1001,  1, 1, "squares"},
+};
+
+/* ----------------------------------- runner ----------------------------------- */
+
+static const bench_case *groups[BENCH_MAX_GROUPS] = { cases };
+static int group_sizes[BENCH_MAX_GROUPS] = { sizeof(cases) / sizeof(cases[0]) };
+static int group_count = 1;
+
+/**
+* Add a table of cases (kept by reference) to the suite.
+* Returns 0 when there is no room left.
+*/
+int bench_register(const bench_case *table, int count)
+{
+    if (group_count == BENCH_MAX_GROUPS)
+        return 0;
+    groups[group_count] = table;
+    group_sizes[group_count] = count;
+    group_count++;
+    return 1;
+}
+
+static int starts_with(const char *s, const char *prefix)
+{
+    while (*prefix)
+        if (*s++ != *prefix++)
+            return 0;
+    return 1;
+}
+
+/* Start the PMU cycle counter: 64-bit, counting at EL1 */
+static void pmu_init()
+{
+    unsigned long pmcr;
+    asm volatile ("mrs %0, pmcr_el0" : "=r"(pmcr));
+    asm volatile ("msr pmcr_el0, %0" :: "r"(pmcr | (1 << 6) | 1)); // LC, E
+    asm volatile ("msr pmccfiltr_el0, %0" :: "r"(0UL));
+    asm volatile ("msr pmcntenset_el0, %0" :: "r"(1UL << 31));
+    asm volatile ("isb");
+}
+
+static inline unsigned long pmu_cycles()
+{
+    unsigned long c;
+    asm volatile ("isb; mrs %0, pmccntr_el0" : "=r"(c));
+    return c;
+}
+
+static void sort(unsigned long *v, int n)
+{
+    for (int i = 1; i < n; i++) {
+        unsigned long x = v[i];
+        int j = i;
+        for (; j > 0 && v[j - 1] > x; j--)
+            v[j] = v[j - 1];
+        v[j] = x;
+    }
+}
+
+/* "12.3 M<unit>/s" in 12 columns */
+static void print_rate(unsigned long per_s, const char *unit)
+{
+    static const char prefixes[] = " KMG";
+    unsigned long tenths = per_s * 10;
+    int p = 0;
+    while (tenths >= 10000 && p < 3) {
+        tenths /= 1000;
+        p++;
+    }
+    printf("%5lu.%lu %c%s/s", tenths / 10, tenths % 10, prefixes[p], unit);
+}
+
+static void bench_run(const bench_case *c, int machine)
+{
+    unsigned long ps[BENCH_SAMPLES], cycles[BENCH_SAMPLES];
+
+    bench_work = 0;
+    c->run(c->iters / 10 + 1); // warm up caches and branch predictors
+    for (int s = 0; s < BENCH_SAMPLES; s++) {
+        unsigned long t0 = now_cycles(), c0 = pmu_cycles();
+        c->run(c->iters);
+        unsigned long c1 = pmu_cycles(), t1 = now_cycles();
+
+        // picoseconds per iteration, to print three decimals of ns
+        ps[s] = (unsigned long)((unsigned __int128)(t1 - t0) * 1000000000000UL
+                                / clock_freq / c->iters);
+        cycles[s] = (c1 - c0) * 1000 / c->iters;
+    }
+    sort(ps, BENCH_SAMPLES);
+    sort(cycles, BENCH_SAMPLES);
+
+    unsigned long median = ps[BENCH_SAMPLES / 2];
+    unsigned long p90 = ps[(BENCH_SAMPLES * 9 + 9) / 10 - 1];
+    unsigned long mcycles = cycles[BENCH_SAMPLES / 2];
+    unsigned long work = bench_work ? bench_work : c->work;
+    unsigned long per_s = work && median
+        ? (unsigned long)((unsigned __int128)work * 1000000000000UL / median) : 0;
+
+    if (machine) {
+        printf("bench,%s,%u,%lu,%lu,%lu,%lu,%s\n", c->name, c->iters, median, p90,
+               mcycles, per_s, work ? c->unit : "");
+        return;
+    }
+    printf("%-18s %6u %9lu.%03lu %9lu.%03lu %9lu.%01lu ", c->name, c->iters,
+           median / 1000, median % 1000, p90 / 1000, p90 % 1000,
+           mcycles / 1000, mcycles % 1000 / 100);
+    if (work)
+        print_rate(per_s, c->unit);
+    printf("\n");
+}
+
+/* Whether a case is selected: its name starts with one of the prefixes, or there are none */
+static int bench_selected(const char *name, char **prefixes, int count)
+{
+    for (int i = 0; i < count; i++)
+        if (starts_with(name, prefixes[i]))
+            return 1;
+    return count == 0;
+}
+
+/**
+* Run the cases whose name starts with one of the count prefixes (all
+* when count is 0), each once and in table order. With machine set,
+* print one CSV line per case instead of the table:
+*   bench,name,iters,median_ps,p90_ps,median_millicycles,units_per_s,unit
+*/
+void bench_command(char **prefixes, int count, int machine)
+{
+    pmu_init();
+    if (machine)
+        printf("# bench,name,iters,median_ps,p90_ps,median_millicycles,units_per_s,unit\n");
+    else
+        printf("%-18s %6s %13s %13s %11s %s\n", "case", "iters", "median ns", "p90 ns",
+               "cycles", "throughput");
+
+    for (int g = 0; g < group_count; g++) {
+        for (int i = 0; i < group_sizes[g]; i++) {
+            const bench_case *c = &groups[g][i];
+            if (bench_selected(c->name, prefixes, count))
+                bench_run(c, machine);
+        }
+    }
+}
@@ -0,0 +1,39 @@
+// -----------------------------------bench.h -------------------------------------
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+* Microbenchmarks. Each case is run once to warm up, then BENCH_SAMPLES
+* times for `iters` iterations, every sample timed with both the generic
+* counter (CNTPCT_EL0) and the PMU cycle counter (PMCCNTR_EL0). The table
+* shows the median and 90th percentile time per iteration, the median
+* cycles per iteration and, for cases that declare how much work an
+* iteration does, the throughput at the median.
+*
+* bench.c holds the cases that only need the drivers; code elsewhere
+* (e.g. the game renderer in main.c) adds its own with bench_register().
+*/
+#define BENCH_SAMPLES 11
+#define BENCH_MAX_GROUPS 8
+
+/* A benchmark case runs `iters` iterations of its workload */
+typedef struct {
+    const char *name;
+    void (*run)(unsigned int iters);
+    unsigned int iters;
+    unsigned long work;     // units processed per iteration, 0 when not meaningful
+    const char *unit;       // e.g. "B", "px", "cells"
+} bench_case;
+
+/* Keeps results alive so the compiler cannot drop the measured work */
+extern volatile unsigned long bench_sink;
+
+/* Set by a case whose work per iteration depends on its input (e.g. the
+   nodes a search expands); takes the place of work when nonzero */
+extern unsigned long bench_work;
+
+/* Function prototypes */
+int bench_register(const bench_case *cases, int count);
+void bench_command(char **prefixes, int count, int machine);
+
+#endif
@@ -0,0 +1,147 @@
+// -----------------------------------clock.c -------------------------------------
+#include "clock.h"
+#include "printf.h"
+#include "string.h"
+#include "../uart/uart.h"
+
+unsigned long clock_freq;
+unsigned long clock_ns_mult;
+unsigned long clock_ticks_mult;
+
+static prof_hist *prof_list = 0;
+
+/**
+* Read the counter frequency once and precompute the conversion factors
+*/
+void clock_init()
+{
+    asm volatile ("mrs %0, cntfrq_el0" : "=r"(clock_freq));
+    clock_ns_mult = (1000000000UL << 32) / clock_freq;
+    clock_ticks_mult = (clock_freq << 32) / 1000000;
+}
+
+
+/* ----------------------------------- histograms ------------------------------------- */
+
+static unsigned int prof_bucket(unsigned long v)
+{
+    if (v < PROF_SUB)
+        return v;
+    int e = 63 - __builtin_clzl(v);
+    if (e >= PROF_MAX_EXP)
+        return PROF_BUCKETS - 1;
+    return (e - PROF_SUB_BITS + 1) * PROF_SUB + ((v >> (e - PROF_SUB_BITS)) & (PROF_SUB - 1));
+}
+
+/* Smallest value of a bucket */
+static unsigned long prof_bucket_low(unsigned int i)
+{
+    if (i < PROF_SUB)
+        return i;
+    int e = i / PROF_SUB + PROF_SUB_BITS - 1;
+    return (unsigned long)(PROF_SUB + i % PROF_SUB) << (e - PROF_SUB_BITS);
+}
+
+/**
+* Add a sample (nanoseconds) to a histogram
+*/
+void prof_record(prof_hist *h, unsigned long ns)
+{
+    if (!h->registered) {
+        h->registered = 1;
+        h->next = prof_list;
+        prof_list = h;
+        h->min_ns = ~0UL;
+    }
+    h->count++;
+    h->sum_ns += ns;
+    if (ns < h->min_ns)
+        h->min_ns = ns;
+    if (ns > h->max_ns)
+        h->max_ns = ns;
+    h->buckets[prof_bucket(ns)]++;
+}
+
+void prof_scope_end(prof_scope *s)
+{
+    prof_record(s->hist, cycles_to_ns(now_cycles() - s->start));
+}
+
+/**
+* Value below which a fraction (per mille) of the samples fall, to bucket precision
+*/
+static unsigned long prof_percentile(const prof_hist *h, unsigned int per_mille)
+{
+    unsigned long rank = (h->count * per_mille + 999) / 1000, seen = 0;
+    for (unsigned int i = 0; i < PROF_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank && seen > 0) {
+            unsigned long high = i + 1 < PROF_BUCKETS ? prof_bucket_low(i + 1) - 1 : h->max_ns;
+            return high < h->max_ns ? high : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+void prof_reset()
+{
+    for (prof_hist *h = prof_list; h; h = h->next) {
+        h->count = h->sum_ns = h->max_ns = 0;
+        h->min_ns = ~0UL;
+        for (unsigned int i = 0; i < PROF_BUCKETS; i++)
+            h->buckets[i] = 0;
+    }
+}
+
+/* Non-empty buckets of one histogram, with a bar scaled to the largest */
+static void prof_dump(const prof_hist *h)
+{
+    unsigned int top = 1;
+    for (unsigned int i = 0; i < PROF_BUCKETS; i++)
+        if (h->buckets[i] > top)
+            top = h->buckets[i];
+
+    printf("%s: %lu samples\n", h->name, h->count);
+    for (unsigned int i = 0; i < PROF_BUCKETS; i++) {
+        if (h->buckets[i] == 0)
+            continue;
+        char bar[41];
+        int n = (int)((unsigned long)h->buckets[i] * 40 / top);
+        for (int k = 0; k < n; k++)
+            bar[k] = '#';
+        bar[n] = '\0';
+        printf(">= %12lu ns %10u %s\n", prof_bucket_low(i), h->buckets[i], bar);
+    }
+}
+
+/**
+* prof           summary of every histogram (ns)
+* prof <name>    buckets of one histogram
+* prof reset     clear all samples
+*/
+void prof_command(const char *arg)
+{
+    if (arg && strcmp(arg, "reset") == 0) {
+        prof_reset();
+        return;
+    }
+    if (arg) {
+        for (prof_hist *h = prof_list; h; h = h->next)
+            if (strcmp(arg, h->name) == 0) {
+                prof_dump(h);
+                return;
+            }
+        uart_puts("No such histogram\n");
+        return;
+    }
+
+    printf("%-20s %8s %10s %10s %10s %10s %10s %10s\n",
+           "name", "count", "min", "avg", "p50", "p90", "p99", "max");
+    for (prof_hist *h = prof_list; h; h = h->next) {
+        if (h->count == 0)
+            continue;
+        printf("%-20s %8lu %10lu %10lu %10lu %10lu %10lu %10lu\n", h->name, h->count,
+               h->min_ns, h->sum_ns / h->count, prof_percentile(h, 500),
+               prof_percentile(h, 900), prof_percentile(h, 990), h->max_ns);
+    }
+}
@@ -0,0 +1,100 @@
+// -----------------------------------clock.h -------------------------------------
+#ifndef CLOCK_H
+#define CLOCK_H
+
+/*
+* Monotonic clock on the ARM generic counter (CNTPCT_EL0)
+*
+* clock_init() caches the counter frequency and precomputes 32.32 fixed
+* point factors, so conversions are a multiply and a shift.
+*/
+
+extern unsigned long clock_freq;       // counter ticks per second
+extern unsigned long clock_ns_mult;    // ns per tick, 32.32 fixed point
+extern unsigned long clock_ticks_mult; // ticks per us, 32.32 fixed point
+
+/* Counter ticks since boot ("cycles" of the system counter) */
+static inline unsigned long now_cycles()
+{
+    unsigned long t;
+    asm volatile ("isb; mrs %0, cntpct_el0" : "=r"(t));
+    return t;
+}
+
+static inline unsigned long cycles_to_ns(unsigned long cycles)
+{
+    return (unsigned long)(((unsigned __int128)cycles * clock_ns_mult) >> 32);
+}
+
+/* Ticks for a duration in microseconds, rounded up */
+static inline unsigned long us_to_cycles(unsigned long us)
+{
+    return (unsigned long)(((unsigned __int128)us * clock_ticks_mult + 0xFFFFFFFF) >> 32);
+}
+
+static inline unsigned long now_ns()
+{
+    return cycles_to_ns(now_cycles());
+}
+
+static inline unsigned long now_us()
+{
+    return now_ns() / 1000;
+}
+
+/*
+* Profiling: log-linear latency histograms
+*
+* A value v >= PROF_SUB lands in power-of-two range 2^e <= v < 2^(e+1),
+* split linearly into PROF_SUB buckets (12.5% wide with PROF_SUB 8).
+* Values below PROF_SUB get a bucket each; values of 2^PROF_MAX_EXP ns or
+* more share the last bucket.
+*
+*   void draw_frame() {
+*       PROF_SCOPE("draw_frame"); // times the rest of the enclosing block
+*       ...
+*   }
+*
+* A histogram registers itself on its first sample; `prof` prints them all.
+* Each histogram should only be fed from one context (not from both an
+* IRQ handler and the code it interrupts).
+*/
+#define PROF_SUB_BITS 3
+#define PROF_SUB (1 << PROF_SUB_BITS)
+#define PROF_MAX_EXP 40
+#define PROF_BUCKETS ((PROF_MAX_EXP - PROF_SUB_BITS + 1) * PROF_SUB)
+
+typedef struct prof_hist {
+    const char *name;
+    struct prof_hist *next;       // registered histograms
+    int registered;
+    unsigned long count, sum_ns, min_ns, max_ns;
+    unsigned int buckets[PROF_BUCKETS];
+} prof_hist;
+
+typedef struct {
+    prof_hist *hist;
+    unsigned long start;
+} prof_scope;
+
+#define PROF_CAT_(a, b) a##b
+#define PROF_CAT(a, b) PROF_CAT_(a, b)
+
+/* Time from here to the end of the enclosing block into histogram label */
+#define PROF_SCOPE(label) \
+    static prof_hist PROF_CAT(prof_hist_, __LINE__) = { .name = label }; \
+    prof_scope PROF_CAT(prof_scope_, __LINE__) __attribute__((cleanup(prof_scope_end))) = \
+        { &PROF_CAT(prof_hist_, __LINE__), now_cycles() }
+
+/* Explicit begin/end pair for spans that are not a block */
+#define PROF_BEGIN(var) unsigned long var = now_cycles()
+#define PROF_END(var, hist) prof_record(hist, cycles_to_ns(now_cycles() - (var)))
+
+/* Function prototypes */
+void clock_init();
+void prof_record(prof_hist *h, unsigned long ns);
+void prof_scope_end(prof_scope *s);
+void prof_reset();
+void prof_command(const char *arg);
+
+#endif
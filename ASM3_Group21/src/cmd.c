@@ -0,0 +1,218 @@
+// -----------------------------------cmd.c -------------------------------------
+#include "cmd.h"
+#include "printf.h"
+#include "string.h"
+#include "../uart/uart.h"
+
+static const cmd *cmd_table[CMD_MAX];   // registration order, for `help`
+static int cmd_count = 0;
+static const cmd *cmd_hash[CMD_HASH_SIZE];
+
+/* Prefix trie: node 0 is the root, index 0 in a link means none */
+typedef struct {
+    char c;
+    short child;        // first child (children sorted by c)
+    short sibling;      // next child of the same parent
+    short count;        // commands at or below this node
+    const cmd *entry;   // command whose name ends here
+} trie_node;
+
+static trie_node trie[CMD_TRIE_NODES];
+static int trie_used = 1;
+
+/* FNV-1a */
+static unsigned int cmd_hash_name(const char *s)
+{
+    unsigned int h = 2166136261u;
+    while (*s)
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+/**
+* Find a command by name (NULL when unknown)
+*/
+const cmd *cmd_find(const char *name)
+{
+    unsigned int i = cmd_hash_name(name) & (CMD_HASH_SIZE - 1);
+
+    // linear probing; the table is at most half full so an empty slot ends the chain
+    while (cmd_hash[i]) {
+        if (strcmp(cmd_hash[i]->name, name) == 0)
+            return cmd_hash[i];
+        i = (i + 1) & (CMD_HASH_SIZE - 1);
+    }
+    return 0;
+}
+
+static int trie_insert(const cmd *c)
+{
+    int len = 0;
+    while (c->name[len])
+        len++;
+    if (trie_used + len > CMD_TRIE_NODES)
+        return 0;
+
+    int n = 0;
+    trie[0].count++;
+    for (const char *p = c->name; *p; p++) {
+        short *link = &trie[n].child;
+        while (*link && trie[*link].c < *p)
+            link = &trie[*link].sibling;
+        if (*link == 0 || trie[*link].c != *p) {
+            int fresh = trie_used++;
+            trie[fresh].c = *p;
+            trie[fresh].sibling = *link;
+            *link = fresh;
+        }
+        n = *link;
+        trie[n].count++;
+    }
+    trie[n].entry = c;
+    return 1;
+}
+
+/* Node reached by the prefix, -1 when no name starts with it */
+static int trie_find(const char *prefix)
+{
+    int n = 0;
+    for (; *prefix; prefix++) {
+        int child = trie[n].child;
+        while (child && trie[child].c < *prefix)
+            child = trie[child].sibling;
+        if (child == 0 || trie[child].c != *prefix)
+            return -1;
+        n = child;
+    }
+    return n;
+}
+
+/**
+* Register the commands of a table (kept by reference). Returns how many
+* were added: duplicates and entries beyond the limits are skipped.
+*/
+int cmd_init(const cmd *table, int count)
+{
+    int added = 0;
+
+    for (int i = 0; i < count; i++) {
+        const cmd *c = &table[i];
+        if (cmd_count == CMD_MAX || cmd_find(c->name) || !trie_insert(c)) {
+            printf("cmd: cannot register %s\n", c->name);
+            continue;
+        }
+        unsigned int h = cmd_hash_name(c->name) & (CMD_HASH_SIZE - 1);
+        while (cmd_hash[h])
+            h = (h + 1) & (CMD_HASH_SIZE - 1);
+        cmd_hash[h] = c;
+        cmd_table[cmd_count++] = c;
+        added++;
+    }
+    return added;
+}
+
+/**
+* Run argv[0] with its arguments. Returns 0 when there is no such command;
+* a wrong number of arguments prints the usage instead.
+*/
+int cmd_dispatch(int argc, char **argv)
+{
+    if (argc == 0)
+        return 1;
+
+    const cmd *c = cmd_find(argv[0]);
+    if (c == 0)
+        return 0;
+    if (argc - 1 < c->min_args || argc - 1 > c->max_args) {
+        printf("Usage: %s\n", c->usage);
+        return 1;
+    }
+    c->run(argc, argv);
+    return 1;
+}
+
+/**
+* Split a command line into words at spaces (in place) and dispatch it.
+* Returns 0 when the command is unknown, 1 otherwise (empty lines included).
+*/
+int cmd_execute(char *line)
+{
+    char *argv[CMD_MAX_ARGS];
+    int argc = 0;
+
+    while (*line) {
+        if (*line == ' ') {
+            *line++ = '\0';
+            continue;
+        }
+        if (argc == CMD_MAX_ARGS) {
+            printf("cmd: more than %d words\n", CMD_MAX_ARGS);
+            return 1;
+        }
+        argv[argc++] = line;
+        while (*line && *line != ' ')
+            line++;
+    }
+    return cmd_dispatch(argc, argv);
+}
+
+/* One line per command, in registration order */
+void cmd_print_summary()
+{
+    for (int i = 0; i < cmd_count; i++)
+        printf("%-37s%s\n", cmd_table[i]->usage, cmd_table[i]->summary);
+}
+
+/* Full help of one command, 0 when unknown */
+int cmd_print_help(const char *name)
+{
+    const cmd *c = cmd_find(name);
+    if (c == 0)
+        return 0;
+    printf("Usage: %s\n", c->usage);
+    uart_puts((char *)c->help);
+    return 1;
+}
+
+/**
+* Tab completion: copy prefix to out, extended as far as every command
+* starting with it agrees (to the full name when there is only one).
+* Returns the number of commands starting with prefix.
+*/
+int cmd_complete(const char *prefix, char *out, int out_size)
+{
+    int n = trie_find(prefix);
+    if (n < 0) {
+        out[0] = '\0';
+        return 0;
+    }
+
+    int len = 0;
+    while (prefix[len] && len < out_size - 1) {
+        out[len] = prefix[len];
+        len++;
+    }
+    while (trie[n].entry == 0 && trie[n].child && trie[trie[n].child].sibling == 0
+           && len < out_size - 1) {
+        n = trie[n].child;
+        out[len++] = trie[n].c;
+    }
+    out[len] = '\0';
+    return trie[n].count;
+}
+
+static void trie_print(int n)
+{
+    if (trie[n].entry)
+        printf(" %s", trie[n].entry->name);
+    for (int child = trie[n].child; child; child = trie[child].sibling)
+        trie_print(child);
+}
+
+/* " name" for every command starting with prefix, alphabetically */
+void cmd_print_matches(const char *prefix)
+{
+    int n = trie_find(prefix);
+    if (n >= 0)
+        trie_print(n);
+}
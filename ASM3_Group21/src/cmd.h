@@ -0,0 +1,47 @@
+// -----------------------------------cmd.h -------------------------------------
+#ifndef CMD_H
+#define CMD_H
+
+/*
+* Command registry: one table entry per shell command holds everything
+* about it (name, handler, accepted argument count, help texts).
+*
+* cmd_init() indexes the table twice: an open-addressing hash table for
+* dispatch (a lookup costs one hash of the name and, almost always, one
+* compare, however many commands there are) and a prefix trie with
+* children in alphabetical order for tab completion.
+*
+*   static void cmd_clear(int argc, char **argv) { ... }
+*   static const cmd commands[] = {
+*       { "clear", cmd_clear, 0, 0, "clear", "Clear screen", "...\n" },
+*   };
+*   cmd_init(commands, sizeof(commands) / sizeof(commands[0]));
+*/
+#define CMD_MAX 64          //commands in the registry
+#define CMD_HASH_SIZE 128   //hash slots, power of two, at least twice CMD_MAX
+#define CMD_TRIE_NODES 512  //trie nodes, at most the total length of all names
+#define CMD_MAX_ARGS 32     //words in a command line, name included
+
+/* argv[0] is the command name, argv[1..argc-1] its arguments */
+typedef void (*cmd_handler)(int argc, char **argv);
+
+typedef struct {
+    const char *name;
+    cmd_handler run;
+    int min_args, max_args;  // arguments accepted after the name
+    const char *usage;       // e.g. "bench [name]"
+    const char *summary;     // one line, for `help`
+    const char *help;        // full text, for `help <name>`
+} cmd;
+
+/* Function prototypes */
+int cmd_init(const cmd *table, int count);
+const cmd *cmd_find(const char *name);
+int cmd_dispatch(int argc, char **argv);
+int cmd_execute(char *line);
+void cmd_print_summary();
+int cmd_print_help(const char *name);
+int cmd_complete(const char *prefix, char *out, int out_size);
+void cmd_print_matches(const char *prefix);
+
+#endif
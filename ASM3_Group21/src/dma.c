@@ -0,0 +1,54 @@
+// -----------------------------------dma.c -------------------------------------
+#include "dma.h"
+
+/**
+* Enable a DMA channel and reset it to a known idle state
+*/
+void dma_init(int ch)
+{
+    DMA_ENABLE |= (1 << ch);
+    DMA_CS(ch) = DMA_CS_RESET;
+    while (DMA_CS(ch) & DMA_CS_RESET)
+        asm volatile("nop");
+    DMA_CS(ch) = DMA_CS_END | DMA_CS_INT; //clear stale completion flags
+}
+
+/**
+* Start executing a chain of control blocks on a channel
+*/
+void dma_start(int ch, dma_cb *cb)
+{
+    DMA_CONBLK_AD(ch) = DMA_BUS_MEM(cb);
+    DMA_CS(ch) = DMA_CS_ACTIVE | DMA_CS_END | DMA_CS_INT | DMA_CS_WAIT_WRITES
+               | DMA_CS_PRIORITY(8) | DMA_CS_PANIC_PRIORITY(8);
+}
+
+/**
+* Is the channel still working through its control blocks?
+*/
+int dma_busy(int ch)
+{
+    return (DMA_CS(ch) & DMA_CS_ACTIVE) != 0;
+}
+
+/**
+* Returns 1 once the last control block of the chain has completed
+* (the END flag is consumed), 0 otherwise
+*/
+int dma_done(int ch)
+{
+    if (DMA_CS(ch) & DMA_CS_END) {
+        DMA_CS(ch) = DMA_CS_END;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+* Wait for the channel to finish
+*/
+void dma_wait(int ch)
+{
+    while (dma_busy(ch))
+        asm volatile("nop");
+}
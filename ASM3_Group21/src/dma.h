@@ -0,0 +1,66 @@
+// -----------------------------------dma.h -------------------------------------
+#ifndef DMA_H
+#define DMA_H
+#include "gpio.h"
+
+/* DMA engine registers (channels 0-14, 0x100 apart) */
+#define DMA_BASE            (MMIO_BASE + 0x00007000)
+#define DMA_CS(ch)          (* (volatile unsigned int*)(DMA_BASE + (unsigned long)(ch) * 0x100 + 0x00))
+#define DMA_CONBLK_AD(ch)   (* (volatile unsigned int*)(DMA_BASE + (unsigned long)(ch) * 0x100 + 0x04))
+#define DMA_TI(ch)          (* (volatile unsigned int*)(DMA_BASE + (unsigned long)(ch) * 0x100 + 0x08))
+#define DMA_TXFR_LEN(ch)    (* (volatile unsigned int*)(DMA_BASE + (unsigned long)(ch) * 0x100 + 0x14))
+#define DMA_DEBUG(ch)       (* (volatile unsigned int*)(DMA_BASE + (unsigned long)(ch) * 0x100 + 0x20))
+#define DMA_INT_STATUS      (* (volatile unsigned int*)(DMA_BASE + 0xFE0))
+#define DMA_ENABLE          (* (volatile unsigned int*)(DMA_BASE + 0xFF0))
+
+/* Control and status bits */
+#define DMA_CS_ACTIVE       (1 << 0)
+#define DMA_CS_END          (1 << 1)  //write 1 to clear
+#define DMA_CS_INT          (1 << 2)  //write 1 to clear
+#define DMA_CS_ERROR        (1 << 8)
+#define DMA_CS_PRIORITY(x)  ((x) << 16)
+#define DMA_CS_PANIC_PRIORITY(x) ((x) << 20)
+#define DMA_CS_WAIT_WRITES  (1 << 28)
+#define DMA_CS_RESET        (1u << 31)
+
+/* Transfer information bits */
+#define DMA_TI_INTEN        (1 << 0)
+#define DMA_TI_WAIT_RESP    (1 << 3)
+#define DMA_TI_DEST_INC     (1 << 4)
+#define DMA_TI_DEST_DREQ    (1 << 6)
+#define DMA_TI_SRC_INC      (1 << 8)
+#define DMA_TI_SRC_DREQ     (1 << 10)
+#define DMA_TI_PERMAP(x)    ((x) << 16)
+#define DMA_TI_NO_WIDE_BURSTS (1 << 26)
+
+/* Peripheral DREQ numbers */
+#define DMA_DREQ_UART_TX    12
+#define DMA_DREQ_UART_RX    14
+
+/* Channel reserved for console transmit (0-4 may be used by the firmware) */
+#define DMA_CH_UART         5
+
+/* DMA sees peripherals at 0x7E000000 and RAM through the uncached 0xC0000000 alias.
+   The data cache is never enabled in this kernel, so no cache maintenance is needed. */
+#define DMA_BUS_PERIPH(X)   ((unsigned int)((unsigned long)(X) - MMIO_BASE + 0x7E000000))
+#define DMA_BUS_MEM(X)      ((unsigned int)((unsigned long)(X) | 0xC0000000))
+
+/* Control block, must be 32-byte aligned */
+typedef struct {
+    unsigned int ti;
+    unsigned int source_ad;
+    unsigned int dest_ad;
+    unsigned int txfr_len;
+    unsigned int stride;
+    unsigned int nextconbk;
+    unsigned int reserved[2];
+} __attribute__((aligned(32))) dma_cb;
+
+/* Function prototypes */
+void dma_init(int ch);
+void dma_start(int ch, dma_cb *cb);
+int dma_busy(int ch);
+int dma_done(int ch);
+void dma_wait(int ch);
+
+#endif
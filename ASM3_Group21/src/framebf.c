@@ -1,6 +1,9 @@
 // ----------------------------------- framebf.c -------------------------------------
 #include "mbox.h"
 #include "../uart/uart.h"
+#include "terminal.h"
+#include "framebf.h"
+#include "stats.h"
 
 //Use RGBA32 (32 bits for each pixel)
 #define COLOR_DEPTH 32
@@ -11,51 +14,30 @@ unsigned int width, height, pitch;
 /* Frame buffer address
 * (declare as pointer of unsigned char to access each byte) */
 unsigned char *fb;
+/* Dirty tile bitmap: one bit per FB_TILE_SIZE x FB_TILE_SIZE block written
+* since the last fb_dirty_clear() (used by incremental screenshots) */
+unsigned long fb_dirty[FB_DIRTY_WORDS];
+unsigned int fb_tiles_x, fb_tiles_y;
+fb_counters fb_stats;
 /**
 * Set screen resolution to 1024x768
 */
 void framebf_init()
 {
-    mBuf[0] = 35*4; // Length of message in bytes
-    mBuf[1] = MBOX_REQUEST;
-    mBuf[2] = MBOX_TAG_SETPHYWH; //Set physical width-height
-    mBuf[3] = 8; // Value size in bytes
-    mBuf[4] = 0; // REQUEST CODE = 0
-    mBuf[5] = 1024; // Value(width)
-    mBuf[6] = 768; // Value(height)
-    mBuf[7] = MBOX_TAG_SETVIRTWH; //Set virtual width-height
-    mBuf[8] = 8;
-    mBuf[9] = 0;
-    mBuf[10] = 1024;
-    mBuf[11] = 768;
-    mBuf[12] = MBOX_TAG_SETVIRTOFF; //Set virtual offset
-    mBuf[13] = 8;
-    mBuf[14] = 0;
-    mBuf[15] = 0; // x offset
-    mBuf[16] = 0; // y offset
-    mBuf[17] = MBOX_TAG_SETDEPTH; //Set color depth
-    mBuf[18] = 4;
-    mBuf[19] = 0;
-    mBuf[20] = COLOR_DEPTH; //Bits per pixel
-    mBuf[21] = MBOX_TAG_SETPXLORDR; //Set pixel order
-    mBuf[22] = 4;
-    mBuf[23] = 0;
-    mBuf[24] = PIXEL_ORDER;
-    mBuf[25] = MBOX_TAG_GETFB; //Get frame buffer
-    mBuf[26] = 8;
-    mBuf[27] = 0;
-    mBuf[28] = 16; //alignment in 16 bytes
-    mBuf[29] = 0; //will return Frame Buffer size in bytes
-    mBuf[30] = MBOX_TAG_GETPITCH; //Get pitch
-    mBuf[31] = 4;
-    mBuf[32] = 0;
-    mBuf[33] = 0; //Will get pitch value here
-    mBuf[34] = MBOX_TAG_LAST;
+    mbox_msg m;
+    mbox_msg_init(&m, mBuf, MBOX_BUF_WORDS);
+    volatile mbox_size *phys = mbox_set_physical_size(&m, 1024, 768);
+    mbox_set_virtual_size(&m, 1024, 768);
+    mbox_set_virtual_offset(&m, 0, 0);
+    volatile mbox_value *depth = mbox_set_depth(&m, COLOR_DEPTH); //Bits per pixel
+    volatile mbox_value *order = mbox_set_pixel_order(&m, PIXEL_ORDER);
+    volatile mbox_fb *frame = mbox_alloc_fb(&m, 16); //alignment in 16 bytes
+    volatile mbox_value *line = mbox_get_pitch(&m);
     // Call Mailbox
-    if (mbox_call(ADDR(mBuf), MBOX_CH_PROP) //mailbox call is successful ?
-        && mBuf[20] == COLOR_DEPTH //got correct color depth ?
-        && mBuf[24] == PIXEL_ORDER //got correct pixel order ?
-        && mBuf[28] != 0 //got a valid address for frame buffer ?
+    if (mbox_msg_send(&m) //mailbox call is successful ?
+        && depth->value == COLOR_DEPTH //got correct color depth ?
+        && order->value == PIXEL_ORDER //got correct pixel order ?
+        && frame->base != 0 //got a valid address for frame buffer ?
     ) {
     /* Convert GPU address to ARM address (clear higher address bits)
     * Frame Buffer is located in RAM memory, which VideoCore MMU
@@ -63,18 +45,21 @@ void framebf_init()
     * Software accessing RAM directly use physical addresses
     * (based at 0x00000000)
     */
-        mBuf[28] &= 0x3FFFFFFF;
+        unsigned int base = frame->base & 0x3FFFFFFF;
         // Access frame buffer as 1 byte per each address
-        fb = (unsigned char *)((unsigned long)mBuf[28]);
+        fb = (unsigned char *)((unsigned long)base);
         uart_puts("Got allocated Frame Buffer at RAM physical address: ");
-        uart_hex(mBuf[28]);
+        uart_hex(base);
         uart_puts("\n");
         uart_puts("Frame Buffer Size (bytes): ");
-        uart_dec(mBuf[29]);
+        uart_dec(frame->size);
         uart_puts("\n");
-        width = mBuf[5]; // Actual physical width
-        height = mBuf[6]; // Actual physical height
-        pitch = mBuf[33]; // Number of bytes per line
+        width = phys->width; // Actual physical width
+        height = phys->height; // Actual physical height
+        pitch = line->value; // Number of bytes per line
+        fb_tiles_x = (width + FB_TILE_SIZE - 1) >> FB_TILE_SHIFT;
+        fb_tiles_y = (height + FB_TILE_SIZE - 1) >> FB_TILE_SHIFT;
+        fb_dirty_all();
     } else {
         uart_puts("Unable to get a frame buffer with provided setting\n");
     }
@@ -90,6 +75,31 @@ void drawPixelARGB32(int x, int y, unsigned int attr)
     */
     //Access 32-bit together
     *((unsigned int*)(fb + offs)) = attr;
+
+    unsigned int tile = (y >> FB_TILE_SHIFT) * fb_tiles_x + (x >> FB_TILE_SHIFT);
+    fb_dirty[tile >> 6] |= 1UL << (tile & 63);
+    STAT_INC(fb_stats.pixels);
+}
+
+/**
+* Mark every tile as changed
+*/
+void fb_dirty_all()
+{
+    unsigned int tiles = fb_tiles_x * fb_tiles_y;
+    for (unsigned int i = 0; i < FB_DIRTY_WORDS; i++)
+        fb_dirty[i] = 0;
+    for (unsigned int t = 0; t < tiles && t < FB_DIRTY_WORDS * 64; t++)
+        fb_dirty[t >> 6] |= 1UL << (t & 63);
+}
+
+/**
+* Forget all changes (after they have been captured)
+*/
+void fb_dirty_clear()
+{
+    for (unsigned int i = 0; i < FB_DIRTY_WORDS; i++)
+        fb_dirty[i] = 0;
 }
 
 void drawRectARGB32(int x1, int y1, int x2, int y2, unsigned int attr, int fill)
@@ -101,4 +111,42 @@ void drawRectARGB32(int x1, int y1, int x2, int y2, unsigned int attr, int fill)
     else if (fill)
         drawPixelARGB32(x, y, attr);
     }
-}
\ No newline at end of file
+}
+
+/**
+* Draw an 8x8 font glyph. attr holds the VGA palette index of the
+* foreground (low nibble) and background (high nibble) colors
+*/
+void drawChar(unsigned char ch, int x, int y, unsigned char attr)
+{
+    unsigned char *glyph = font[ch < FONT_NUMGLYPHS ? ch : 0];
+
+    STAT_INC(fb_stats.blits);
+
+    for (int i = 0; i < FONT_HEIGHT; i++) {
+        for (int j = 0; j < FONT_WIDTH; j++) {
+            unsigned char col = (glyph[i] & (1 << j)) ? (attr & 0x0F) : ((attr & 0xF0) >> 4);
+            drawPixelARGB32(x + j, y + i, vgapal[col]);
+        }
+    }
+}
+
+/**
+* Draw a string, '\n' moves to the next text line starting at x
+*/
+void drawString(int x, int y, char *s, unsigned char attr)
+{
+    int startX = x;
+    while (*s) {
+        if (*s == '\r') {
+            x = startX;
+        } else if (*s == '\n') {
+            x = startX;
+            y += FONT_HEIGHT;
+        } else {
+            drawChar(*s, x, y, attr);
+            x += FONT_WIDTH;
+        }
+        s++;
+    }
+}
@@ -1,3 +1,14 @@
+/* Screen info (set by framebf_init) */
+extern unsigned int width, height, pitch;
+extern unsigned char *fb;
+
+/* Dirty tile tracking: 32x32 pixel tiles, up to 2048x2048 pixels */
+#define FB_TILE_SHIFT 5
+#define FB_TILE_SIZE (1 << FB_TILE_SHIFT)
+#define FB_DIRTY_WORDS ((2048 / FB_TILE_SIZE) * (2048 / FB_TILE_SIZE) / 64)
+extern unsigned long fb_dirty[FB_DIRTY_WORDS];
+extern unsigned int fb_tiles_x, fb_tiles_y;
+
 void framebf_init();
 void drawPixelARGB32(int x, int y, unsigned int attr);
 void drawRectARGB32(int x1, int y1, int x2, int y2, unsigned int attr, int fill);
@@ -5,4 +16,6 @@ void drawChar(unsigned char ch, int x, int y, unsigned char attr);
 void drawString(int x, int y, char *s, unsigned char attr);
 void drawRect(int x1, int y1, int x2, int y2, unsigned char attr, int fill);
 void drawCircle(int x0, int y0, int radius, unsigned char attr, int fill);
-void drawLine(int x1, int y1, int x2, int y2, unsigned char attr);
\ No newline at end of file
+void drawLine(int x1, int y1, int x2, int y2, unsigned char attr);
+void fb_dirty_all();
+void fb_dirty_clear();
\ No newline at end of file
@@ -0,0 +1,94 @@
+// -----------------------------------irq.c -------------------------------------
+#include "irq.h"
+#include "../uart/uart.h"
+#include "printf.h"
+
+extern char vectors[];
+
+static irq_handler irq_handlers[IRQ_COUNT];
+static void *irq_ctx[IRQ_COUNT];
+static unsigned int irq_spurious = 0;
+
+/**
+* Install the exception vectors. IRQs stay masked until irq_enable()
+*/
+void irq_init()
+{
+    asm volatile ("msr vbar_el1, %0; isb" :: "r"(vectors));
+}
+
+/**
+* Call handler(ctx) from IRQ context whenever irq is pending.
+* The handler must clear the interrupt at its source.
+*/
+void irq_register(unsigned int irq, irq_handler handler, void *ctx)
+{
+    if (irq >= IRQ_COUNT)
+        return;
+    irq_ctx[irq] = ctx;
+    irq_handlers[irq] = handler;
+}
+
+/**
+* Let the interrupt controller forward irq to the core
+*/
+void irq_unmask(unsigned int irq)
+{
+    if (irq < 32)
+        ENABLE_IRQS_1 = 1 << irq;
+    else if (irq < 64)
+        ENABLE_IRQS_2 = 1 << (irq - 32);
+    else if (irq < IRQ_ARM_BASIC(8))
+        ENABLE_BASIC_IRQS = 1 << (irq - 64);
+    else if (irq >= IRQ_LOCAL(0) && irq < IRQ_LOCAL(4))
+        CORE0_TIMER_IRQCNTL |= 1 << (irq - IRQ_LOCAL(0));
+}
+
+void irq_mask(unsigned int irq)
+{
+    if (irq < 32)
+        DISABLE_IRQS_1 = 1 << irq;
+    else if (irq < 64)
+        DISABLE_IRQS_2 = 1 << (irq - 32);
+    else if (irq < IRQ_ARM_BASIC(8))
+        DISABLE_BASIC_IRQS = 1 << (irq - 64);
+    else if (irq >= IRQ_LOCAL(0) && irq < IRQ_LOCAL(4))
+        CORE0_TIMER_IRQCNTL &= ~(1 << (irq - IRQ_LOCAL(0)));
+}
+
+static void irq_dispatch(unsigned int base, unsigned int pending)
+{
+    while (pending) {
+        unsigned int irq = base + __builtin_ctz(pending);
+        pending &= pending - 1;
+        if (irq_handlers[irq])
+            irq_handlers[irq](irq_ctx[irq]);
+        else
+            irq_spurious++;
+    }
+}
+
+/**
+* Called from the IRQ vector (vectors.S) with IRQs masked
+*/
+void irq_handle()
+{
+    unsigned int source = CORE0_IRQ_SOURCE;
+
+    irq_dispatch(IRQ_LOCAL(0), source & ~LOCAL_IRQ_GPU & 0xFFF);
+    if (source & LOCAL_IRQ_GPU) {
+        irq_dispatch(IRQ_ARM_BASIC(0), IRQ_BASIC_PENDING & 0xFF);
+        irq_dispatch(0, IRQ_PENDING_1);
+        irq_dispatch(32, IRQ_PENDING_2);
+    }
+}
+
+/**
+* Called from vectors.S for every exception other than an EL1 IRQ
+*/
+void exc_unhandled(unsigned long type, unsigned long esr, unsigned long elr, unsigned long far)
+{
+    printf("\nUnhandled exception %d: ESR %lx ELR %lx FAR %lx\n", (int)type, esr, elr, far);
+    while (1)
+        asm volatile ("wfe");
+}
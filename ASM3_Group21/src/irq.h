@@ -0,0 +1,74 @@
+// -----------------------------------irq.h -------------------------------------
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "gpio.h"
+
+/* ARM interrupt controller (BCM2837) */
+#define IRQ_BASIC_PENDING   (* (volatile unsigned int*)(MMIO_BASE+0x0000B200))
+#define IRQ_PENDING_1       (* (volatile unsigned int*)(MMIO_BASE+0x0000B204))
+#define IRQ_PENDING_2       (* (volatile unsigned int*)(MMIO_BASE+0x0000B208))
+#define ENABLE_IRQS_1       (* (volatile unsigned int*)(MMIO_BASE+0x0000B210))
+#define ENABLE_IRQS_2       (* (volatile unsigned int*)(MMIO_BASE+0x0000B214))
+#define ENABLE_BASIC_IRQS   (* (volatile unsigned int*)(MMIO_BASE+0x0000B218))
+#define DISABLE_IRQS_1      (* (volatile unsigned int*)(MMIO_BASE+0x0000B21C))
+#define DISABLE_IRQS_2      (* (volatile unsigned int*)(MMIO_BASE+0x0000B220))
+#define DISABLE_BASIC_IRQS  (* (volatile unsigned int*)(MMIO_BASE+0x0000B224))
+
+/* Per-core (local) interrupt controller, core 0 */
+#define LOCAL_BASE          0x40000000
+#define CORE0_TIMER_IRQCNTL (* (volatile unsigned int*)(LOCAL_BASE+0x40))
+#define CORE0_IRQ_SOURCE    (* (volatile unsigned int*)(LOCAL_BASE+0x60))
+#define LOCAL_IRQ_GPU       (1 << 8) //a GPU (ARM controller) interrupt is pending
+
+/* Interrupt numbers:
+*   0 - 63  GPU peripherals (IRQ_PENDING_1/2)
+*  64 - 71  ARM basic interrupts (IRQ_BASIC_PENDING)
+*  96 - 107 core 0 local sources (CORE0_IRQ_SOURCE) */
+#define IRQ_ARM_BASIC(n)    (64 + (n))
+#define IRQ_LOCAL(n)        (96 + (n))
+#define IRQ_COUNT           108
+
+#define IRQ_MAILBOX         IRQ_ARM_BASIC(1) //ARM mailbox 0 has data
+#define IRQ_CNTPNS          IRQ_LOCAL(1)     //EL1 physical timer
+
+typedef void (*irq_handler)(void *ctx);
+
+/* Unmask / mask IRQs on this core */
+static inline void irq_enable()
+{
+    asm volatile ("msr daifclr, #2" ::: "memory");
+}
+
+static inline void irq_disable()
+{
+    asm volatile ("msr daifset, #2" ::: "memory");
+}
+
+/* Mask IRQs, returning the previous state for irq_restore() */
+static inline unsigned long irq_save()
+{
+    unsigned long flags;
+    asm volatile ("mrs %0, daif; msr daifset, #2" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(unsigned long flags)
+{
+    asm volatile ("msr daif, %0" :: "r"(flags) : "memory");
+}
+
+static inline int irq_enabled()
+{
+    unsigned long flags;
+    asm volatile ("mrs %0, daif" : "=r"(flags));
+    return !(flags & (1 << 7));
+}
+
+/* Function prototypes */
+void irq_init();
+void irq_register(unsigned int irq, irq_handler handler, void *ctx);
+void irq_unmask(unsigned int irq);
+void irq_mask(unsigned int irq);
+
+#endif
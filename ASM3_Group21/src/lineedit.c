@@ -0,0 +1,370 @@
+// -----------------------------------lineedit.c -------------------------------------
+#include "lineedit.h"
+#include "cmd.h"
+#include "numfmt.h"
+#include "string.h"
+#include "../uart/uart.h"
+
+/* Keys, after escape sequences are decoded */
+#define KEY_UP     0x100
+#define KEY_DOWN   0x101
+#define KEY_RIGHT  0x102
+#define KEY_LEFT   0x103
+#define KEY_HOME   0x104
+#define KEY_END    0x105
+#define KEY_DELETE 0x106
+
+/* Escape sequence parser states */
+#define ESC_NONE 0
+#define ESC_START 1 //got ESC
+#define ESC_CSI 2   //got ESC [, reading the parameter
+#define ESC_SS3 3   //got ESC O
+
+static const char *line_prompt_text = "";
+
+/* The line being edited */
+static char buf[LINE_MAX];
+static int len = 0, cursor = 0;
+
+/* What the terminal shows after the prompt, and where its cursor is */
+static char shown[LINE_MAX];
+static int shown_len = 0, shown_cursor = 0;
+
+static int esc_state = ESC_NONE;
+static int esc_param, esc_more;
+
+/* History ring: entry n (1 = newest) is hist[(hist_added - n) % LINE_HISTORY] */
+static char hist[LINE_HISTORY][LINE_MAX];
+static unsigned int hist_added = 0;
+static int hist_pos = 0;          // entry shown, 0 = the line being typed
+static char draft[LINE_MAX];      // the line being typed, while browsing
+static int draft_len;
+
+/* Finished line handed to the caller, who may tokenize it in place */
+static char line[LINE_MAX];
+
+/* Terminal bytes of one key, sent in a single write */
+static char out[2 * LINE_MAX + 32];
+static int out_len = 0;
+
+static void emit(const char *s, int n)
+{
+    while (n-- > 0)
+        out[out_len++] = *s++;
+}
+
+/* ESC [ n <final>, the relative cursor moves */
+static void emit_csi(int n, char final)
+{
+    char num[NUMFMT_MAX_CHARS];
+    char *p = fmt_u64_dec(num + sizeof(num), n);
+
+    emit("\x1B[", 2);
+    emit(p, num + sizeof(num) - p);
+    out[out_len++] = final;
+}
+
+static void flush()
+{
+    uart_write(out, out_len);
+    out_len = 0;
+}
+
+/* Move the terminal cursor to column col of the line, in the fewest bytes */
+static void move_to(int col)
+{
+    int n = col - shown_cursor;
+
+    if (n < 0 && n >= -3) {
+        while (n++ < 0)
+            out[out_len++] = '\b';
+    } else if (n < 0) {
+        emit_csi(-n, 'D');
+    } else if (n <= 3) {
+        // retyping what is already there is shorter than ESC [ n C
+        // (the columns crossed always show buf: see line_sync)
+        emit(buf + shown_cursor, n);
+    } else {
+        emit_csi(n, 'C');
+    }
+    shown_cursor = col;
+}
+
+/**
+* Bring the terminal up to date with buf: redraw from the first column
+* that differs, then put the cursor back
+*/
+static void line_sync()
+{
+    int i = 0;
+    while (i < len && i < shown_len && buf[i] == shown[i])
+        i++;
+
+    if (i < len || i < shown_len) {
+        // columns before i match, so moving right over them is safe
+        move_to(i);
+        emit(buf + i, len - i);
+        shown_cursor = len;
+        if (shown_len > len)
+            emit("\x1B[K", 3);
+        for (; i < len; i++)
+            shown[i] = buf[i];
+        shown_len = len;
+    }
+    move_to(cursor);
+    flush();
+}
+
+static void line_insert(const char *s, int n)
+{
+    if (n > LINE_MAX - 1 - len) {
+        out[out_len++] = '\a'; // line full
+        n = LINE_MAX - 1 - len;
+    }
+    for (int i = len - 1; i >= cursor; i--)
+        buf[i + n] = buf[i];
+    for (int i = 0; i < n; i++)
+        buf[cursor++] = s[i];
+    len += n;
+}
+
+/* Remove the character at position at */
+static void line_remove(int at)
+{
+    for (int i = at; i < len - 1; i++)
+        buf[i] = buf[i + 1];
+    len--;
+    if (cursor > at)
+        cursor--;
+}
+
+static void line_set(const char *s, int n)
+{
+    for (len = 0; len < n; len++)
+        buf[len] = s[len];
+    cursor = len;
+}
+
+static int hist_count()
+{
+    return hist_added < LINE_HISTORY ? hist_added : LINE_HISTORY;
+}
+
+static const char *hist_entry(int n)
+{
+    return hist[(hist_added - n) % LINE_HISTORY];
+}
+
+/* Step through the history: +1 older, -1 newer */
+static void hist_step(int dir)
+{
+    int pos = hist_pos + dir;
+    if (pos < 0 || pos > hist_count())
+        return;
+
+    if (hist_pos == 0) {
+        for (draft_len = 0; draft_len < len; draft_len++)
+            draft[draft_len] = buf[draft_len];
+    }
+    hist_pos = pos;
+    if (pos == 0)
+        line_set(draft, draft_len);
+    else
+        line_set(hist_entry(pos), strlen(hist_entry(pos)));
+}
+
+/**
+* Remember a line for the arrow keys (empty lines and repeats of the
+* newest entry are skipped; the oldest entry makes room when full)
+*/
+void line_history_add(const char *s)
+{
+    int n = strlen(s);
+    if (n == 0 || n >= LINE_MAX)
+        return;
+    if (hist_count() > 0 && strcmp(s, hist_entry(1)) == 0)
+        return;
+
+    char *slot = hist[hist_added % LINE_HISTORY];
+    for (int i = 0; i <= n; i++)
+        slot[i] = s[i];
+    hist_added++;
+}
+
+/* Tab: complete the command name left of the cursor */
+static void line_complete()
+{
+    char prefix[LINE_MAX], completed[LINE_MAX];
+
+    for (int i = 0; i < cursor; i++) {
+        if (buf[i] == ' ')
+            return; // only command names are completed
+        prefix[i] = buf[i];
+    }
+    prefix[cursor] = '\0';
+
+    int matches = cmd_complete(prefix, completed, LINE_MAX);
+    int extra = (int)strlen(completed) - cursor;
+
+    // one match, or several sharing more than what was typed: complete
+    if (matches > 0 && extra > 0) {
+        line_insert(completed + cursor, extra);
+    } else if (matches > 1) {
+        uart_puts("\nPossible completions:");
+        cmd_print_matches(prefix);
+        uart_puts("\n");
+        line_prompt();
+    } else if (matches == 0) {
+        uart_puts("\nNo suggestions found.\n");
+        line_prompt();
+    }
+}
+
+/* Set the prompt printed by line_prompt() (kept by reference) */
+void line_init(const char *prompt)
+{
+    line_prompt_text = prompt;
+    len = cursor = 0;
+    esc_state = ESC_NONE;
+}
+
+/**
+* Print the prompt and the line being edited, for a fresh terminal line
+*/
+void line_prompt()
+{
+    uart_puts((char *)line_prompt_text);
+    shown_len = shown_cursor = 0;
+    line_sync();
+}
+
+/* Decode escape sequences; returns a key, or 0 while one is incomplete */
+static int line_decode(char c)
+{
+    switch (esc_state) {
+    case ESC_START:
+        esc_state = c == '[' ? ESC_CSI : c == 'O' ? ESC_SS3 : ESC_NONE;
+        esc_param = esc_more = 0;
+        return 0;
+
+    case ESC_CSI:
+        if (c >= '0' && c <= '9') {
+            // keep the first parameter only (ESC [ 1 ; 5 C is Ctrl-Right)
+            if (!esc_more && esc_param < 1000)
+                esc_param = esc_param * 10 + c - '0';
+            return 0;
+        }
+        if (c == ';') {
+            esc_more = 1;
+            return 0;
+        }
+        esc_state = ESC_NONE;
+        if (c == '~') {
+            switch (esc_param) {
+            case 1: case 7: return KEY_HOME;
+            case 4: case 8: return KEY_END;
+            case 3: return KEY_DELETE;
+            }
+            return 0;
+        }
+        break;
+
+    case ESC_SS3:
+        esc_state = ESC_NONE;
+        break;
+
+    default:
+        if (c == 0x1B) {
+            esc_state = ESC_START;
+            return 0;
+        }
+        return (unsigned char)c;
+    }
+
+    // final byte of ESC [ or ESC O
+    switch (c) {
+    case 'A': return KEY_UP;
+    case 'B': return KEY_DOWN;
+    case 'C': return KEY_RIGHT;
+    case 'D': return KEY_LEFT;
+    case 'H': return KEY_HOME;
+    case 'F': return KEY_END;
+    }
+    return 0;
+}
+
+/**
+* Handle one received character. Returns the finished line (without
+* newline) when it was Enter, NULL otherwise. The returned buffer stays
+* valid until the next call.
+*/
+char *line_feed(char c)
+{
+    int key = line_decode(c);
+
+    switch (key) {
+    case 0:
+        return 0;
+    case '\n':
+        buf[len] = '\0';
+        cursor = len;
+        move_to(len);
+        emit("\r\n", 2);
+        flush();
+        line_history_add(buf);
+        for (int i = 0; i <= len; i++)
+            line[i] = buf[i];
+        len = cursor = 0;
+        hist_pos = 0;
+        shown_len = shown_cursor = 0;
+        return line;
+    case 3: // Ctrl-C: drop the line
+        uart_puts("^C\n");
+        len = cursor = 0;
+        hist_pos = 0;
+        line_prompt();
+        return 0;
+    case '\t':
+        line_complete();
+        break;
+    case 127:
+    case '\b':
+        if (cursor > 0)
+            line_remove(cursor - 1);
+        break;
+    case KEY_DELETE:
+        if (cursor < len)
+            line_remove(cursor);
+        break;
+    case KEY_LEFT:
+        if (cursor > 0)
+            cursor--;
+        break;
+    case KEY_RIGHT:
+        if (cursor < len)
+            cursor++;
+        break;
+    case 1: // Ctrl-A
+    case KEY_HOME:
+        cursor = 0;
+        break;
+    case 5: // Ctrl-E
+    case KEY_END:
+        cursor = len;
+        break;
+    case KEY_UP:
+        hist_step(1);
+        break;
+    case KEY_DOWN:
+        hist_step(-1);
+        break;
+    default:
+        if (key >= ' ' && key < 127) {
+            char ch = key;
+            line_insert(&ch, 1);
+        }
+        break;
+    }
+    line_sync();
+    return 0;
+}
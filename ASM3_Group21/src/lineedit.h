@@ -0,0 +1,36 @@
+// -----------------------------------lineedit.h -------------------------------------
+#ifndef LINEEDIT_H
+#define LINEEDIT_H
+
+/*
+* Shell line editor, fed one received character at a time.
+*
+* Understands the VT100/xterm keys sent by serial terminals: arrows (left,
+* right, history up/down), Home/End (ESC [ H, ESC [ F, ESC O H, ESC O F,
+* ESC [ 1~ ... ESC [ 8~) and Delete (ESC [ 3~), plus Backspace, Tab
+* (command completion), Ctrl-A/Ctrl-E (home/end) and Ctrl-C (drop the line).
+*
+* The editor remembers what the terminal shows after the prompt. After each
+* key it sends only the bytes that turn that into the new line: a relative
+* cursor move to the first changed column, the changed tail, an erase to
+* end of line when the line got shorter, and a move back to the cursor.
+* Typing at the end of the line therefore costs one byte, as plain echo did.
+* The prompt and the line are assumed to fit in one terminal row.
+*
+*   line_init("MyBareMetalOS> ");
+*   while (1) {
+*       char *line = line_feed(uart_getc());
+*       if (line) { run(line); line_prompt(); }
+*   }
+*/
+#define LINE_MAX 100        //characters in a line, terminator included
+#define LINE_HISTORY 16     //lines kept in the history ring
+#define INPUT_POLL_MS 5     //serial input polling interval of the shell task
+
+/* Function prototypes */
+void line_init(const char *prompt);
+void line_prompt();
+char *line_feed(char c);
+void line_history_add(const char *line);
+
+#endif
@@ -0,0 +1,96 @@
+// -----------------------------------log.c -------------------------------------
+#include "log.h"
+#include "../uart/uart.h"
+
+unsigned long log_ring[LOG_RING_WORDS];
+unsigned int log_head = 0;
+unsigned int log_tail = 0;
+unsigned int log_dropped = 0;
+
+/* Largest payload of one block sent over the UART */
+#define LOG_BLOCK_SIZE 512
+/* Worst case encoded record: id, timestamp and every argument as 10-byte varints + count */
+#define LOG_RECORD_MAX (2 * 10 + 1 + LOG_MAX_ARGS * 10)
+
+/*
+* Wire format (little endian), one block per LOG_BLOCK_SIZE payload bytes:
+*   "BLOG" | u32 counter frequency | u32 dropped records | u32 payload length | payload
+* Payload: records of
+*   varint id | varint timestamp delta | u8 argument count | zigzag varint arguments
+* The timestamp of the first record in a block is absolute.
+*/
+
+static int put_varint(unsigned char *p, unsigned long v)
+{
+    int n = 0;
+    while (v >= 0x80) {
+        p[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (unsigned char)v;
+    return n;
+}
+
+static void put_u32(unsigned char *p, unsigned int v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static void send_block(unsigned char *block, int len)
+{
+    unsigned long f;
+    asm volatile ("mrs %0, cntfrq_el0" : "=r"(f));
+
+    block[0] = 'B'; block[1] = 'L'; block[2] = 'O'; block[3] = 'G';
+    put_u32(block + 4, (unsigned int)f);
+    put_u32(block + 8, log_dropped);
+    put_u32(block + 12, len);
+    uart_write((char *)block, 16 + len);
+}
+
+/**
+* Send all buffered records over the UART as binary frames
+*/
+void log_drain()
+{
+    unsigned char block[16 + LOG_BLOCK_SIZE];
+    unsigned char *payload = block + 16;
+    int len = 0;
+    unsigned long prev_ts = 0;
+
+    while (log_tail != log_head) {
+        unsigned long header = log_ring[log_tail++ & (LOG_RING_WORDS - 1)];
+        unsigned long ts = log_ring[log_tail++ & (LOG_RING_WORDS - 1)];
+        unsigned int nargs = header & 0xFF;
+
+        if (len + LOG_RECORD_MAX > LOG_BLOCK_SIZE) {
+            send_block(block, len);
+            len = 0;
+        }
+        if (len == 0)
+            prev_ts = 0; //first record of a block carries the absolute time
+
+        len += put_varint(payload + len, header >> 8);
+        len += put_varint(payload + len, ts - prev_ts);
+        payload[len++] = nargs;
+        for (unsigned int i = 0; i < nargs; i++) {
+            long v = (long)log_ring[log_tail++ & (LOG_RING_WORDS - 1)];
+            len += put_varint(payload + len, ((unsigned long)v << 1) ^ (unsigned long)(v >> 63));
+        }
+        prev_ts = ts;
+    }
+    if (len > 0)
+        send_block(block, len);
+}
+
+/**
+* Throw away all buffered records
+*/
+void log_clear()
+{
+    log_tail = log_head;
+    log_dropped = 0;
+}
@@ -0,0 +1,60 @@
+// -----------------------------------log.h -------------------------------------
+#ifndef LOG_H
+#define LOG_H
+
+/*
+* Deferred binary logging
+*
+* LOG("x = %d", x) does not format anything on the target: it stores the
+* address of the format string (its id), a CNTPCT_EL0 timestamp and the raw
+* arguments in a ring buffer. The format strings live in the non-loaded
+* .logfmt section of kernel8.elf, so they cost no space in kernel8.img.
+* log_drain() sends the records as compact binary frames over the UART and
+* tools/logdecode.py turns them back into text using kernel8.elf.
+*
+* Arguments are stored as 64-bit integers: integers, characters and
+* pointers (cast to unsigned long) are supported, %f is not. %s works for
+* strings that are part of the kernel image (e.g. literals).
+*/
+
+/* Ring buffer size in 64-bit words (power of two) */
+#define LOG_RING_WORDS 2048
+#define LOG_MAX_ARGS 8
+
+extern unsigned long log_ring[LOG_RING_WORDS];
+extern unsigned int log_head;    // next word to write (free running)
+extern unsigned int log_tail;    // next word to drain (free running)
+extern unsigned int log_dropped; // records lost because the ring was full
+
+/* Append one record: header word (id << 8 | nargs), timestamp, arguments */
+static inline void log_record(unsigned long id, const unsigned long *args, unsigned int nargs)
+{
+    unsigned int head = log_head;
+    unsigned long ts;
+
+    if (LOG_RING_WORDS - (head - log_tail) < nargs + 2) {
+        log_dropped++;
+        return;
+    }
+    asm volatile ("mrs %0, cntpct_el0" : "=r"(ts));
+    log_ring[head++ & (LOG_RING_WORDS - 1)] = (id << 8) | nargs;
+    log_ring[head++ & (LOG_RING_WORDS - 1)] = ts;
+    for (unsigned int i = 0; i < nargs; i++)
+        log_ring[head++ & (LOG_RING_WORDS - 1)] = args[i];
+    log_head = head;
+}
+
+#define LOG(fmt, ...) do { \
+    static const char log_fmt_[] __attribute__((section(".logfmt"), used)) = fmt; \
+    const unsigned long log_args_[] = { 0, ##__VA_ARGS__ }; \
+    _Static_assert(sizeof(log_args_) / sizeof(log_args_[0]) - 1 <= LOG_MAX_ARGS, \
+                   "too many LOG arguments"); \
+    log_record((unsigned long)log_fmt_, log_args_ + 1, \
+               sizeof(log_args_) / sizeof(log_args_[0]) - 1); \
+} while (0)
+
+/* Function prototypes */
+void log_drain();
+void log_clear();
+
+#endif
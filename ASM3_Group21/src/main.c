@@ -6,21 +6,37 @@
 #include "video.h"
 #include "timer.h"
 #include "Maze.h"
+#include "path.h"
 #include "gameElement.h"
 #include "Frontier.c"
-#define MAX_CMD_SIZE 100
-#define MAX_TOKENS 100
-#define HISTORY_SIZE 10
+#include "log.h"
+#include "bench.h"
+#include "screenshot.h"
+#include "propcache.h"
+#include "irq.h"
+#include "perf.h"
+#include "clock.h"
+#include "sched.h"
+#include "cmd.h"
+#include "lineedit.h"
+#include "script.h"
+#include "stats.h"
+#include "string.h"
 #define MAX_REQ_VALUE 10
+#define GAME_HZ 60 //simulation steps per second
+#define GAME_STEP_US (1000000 / GAME_HZ)
+#define GAME_MAX_CATCHUP 4 //steps run back to back at most, the rest of a stall is dropped
+#define GAME_INPUT_QUEUE 16 //keys buffered between two simulation steps
+#define HINT_MAX 1024 //longest path the hint overlay shows
+#define HINT_COLOR 0x0000C060
 int widthScreen = 40;
 int heightScreen = 20;
-char history[HISTORY_SIZE][MAX_CMD_SIZE];
-int history_count = 0;
-int current_history_index = 0;
-char *maze;
-static unsigned char our_memory[1024 * 1024]; //reserve 1 MB for malloc
+maze_map maze;
+static unsigned char our_memory[1024 * 1024] __attribute__((aligned(16))); //reserve 1 MB for malloc
 static size_t next_index = 0;
-int inGame = 0;
+heap_counters heap_stats;
+game_counters game_stats;
+int inGame = 0; // the game task owns the keyboard
 Frontier *myFrontier;
 
 int x_direct = 20;
@@ -31,11 +47,16 @@ void *malloc(size_t sz)
 {
     void *mem;
 
-    if(sizeof our_memory - next_index < sz)
+    sz = (sz + 15) & ~(size_t)15; // the MMU is off: 64-bit loads must be aligned
+    if(sizeof our_memory - next_index < sz) {
+        STAT_INC(heap_stats.failed);
         return NULL;
+    }
 
     mem = &our_memory[next_index];
     next_index += sz;
+    STAT_ADD(heap_stats.allocated, sz);
+    STAT_SET(heap_stats.live, next_index);
     return mem;
 }
 
@@ -47,6 +68,7 @@ void free(void *mem)
 // Function draw image
 void draw_image()
 {
+    STAT_INC(fb_stats.blits);
     // Looping through image array line by line.
     for (int j = 0; j < 425; j++)
     {
@@ -59,26 +81,27 @@ void draw_image()
     }
 }
 
-void getNearFrontier(const char *maze, int x, int y) {
-    if (y * widthScreen + x - widthScreen < 0) {
+// Squares around the player straight from the maze bits, 10 outside the maze
+void getNearFrontier(const maze_map *maze, int x, int y) {
+    if (y == 0) {
         myFrontier->north = 10;
     }
-    else {    myFrontier->north = maze[y * widthScreen + x - widthScreen];
+    else {    myFrontier->north = maze_square(maze, x, y - 1);
     }
-    if (y * widthScreen + x + 1 > ((y + 1) * widthScreen)) {
+    if (x + 1 >= maze->width) {
         myFrontier->east = 10;
     }
-    else {    myFrontier->east = maze[y * widthScreen + x + 1];
+    else {    myFrontier->east = maze_square(maze, x + 1, y);
     }
-    if (y*widthScreen + x + widthScreen > widthScreen * heightScreen) {
+    if (y + 1 >= maze->height) {
         myFrontier->south = 10;
     }
-    else {    myFrontier->south = maze[y*widthScreen + x + widthScreen];
+    else {    myFrontier->south = maze_square(maze, x, y + 1);
     }
-    if (y * widthScreen + x - 1 < y * widthScreen) {
+    if (x == 0) {
         myFrontier->west = 10;
     }
-    else {    myFrontier->west = maze[y * widthScreen + x - 1];
+    else {    myFrontier->west = maze_square(maze, x - 1, y);
     }
 }
 
@@ -111,29 +134,36 @@ int checkDirection(int dir) {
     return 0;
 }
 
-void drawMap(const char *maze, int widthScreen, int heightScreen) {
-   int x, y;
-   for(y = 0; y < heightScreen; y++) {
-      for(x = 0; x < widthScreen; x++) {
-         switch(maze[y * widthScreen + x]) {
-         case 1:  draw_wall(x * 20, y * 20);  break;
-         case 2:  draw_destination(x * 20,  y * 20);  break;
+// Draw the walls and the destination of the maze, jumping from wall to wall in each row word
+void drawMazeCells(const maze_map *maze) {
+   for(int y = 0; y < maze->height; y++) {
+      const uint64_t *row = maze_row(maze, y);
+      for(int i = 0; i < maze->words; i++) {
+         uint64_t walls = row[i] & maze_word_mask(maze->width, i);
+         while (walls) {
+            draw_wall((64 * i + __builtin_ctzl(walls)) * 20, y * 20);
+            walls &= walls - 1;
          }
       }
    }
-   for (int x = 0; x < widthScreen; x++) {
-        draw_wall(x * 20, heightScreen * 20);
+   if (maze->goal >= 0)
+      draw_destination(maze->goal % maze->width * 20, maze->goal / maze->width * 20);
+}
+
+void drawMap(const maze_map *maze) {
+   drawMazeCells(maze);
+   for (int x = 0; x < maze->width; x++) {
+        draw_wall(x * 20, maze->height * 20);
    }
-   for (int y = 0; y < heightScreen; y++) {
-        draw_wall(widthScreen * 20, y * 20);
+   for (int y = 0; y < maze->height; y++) {
+        draw_wall(maze->width * 20, y * 20);
    }
    while (1) {
-    int var = rand_range(0, widthScreen * heightScreen);
-    if (maze[var] == 0) {
-        int y_index = var / widthScreen;
-        int x_index = var % widthScreen;
-        printf("This is x_index: %d\n", x_index);
-        printf("This is y_index: %d\n", y_index);
+    int var = rand_range(0, maze->width * maze->height - 1);
+    int y_index = var / maze->width;
+    int x_index = var % maze->width;
+    if (maze_square(maze, x_index, y_index) == MAZE_PATH) {
+        LOG("drawMap: player starts at x_index %d, y_index %d", x_index, y_index);
         draw_destination(x_index * 20, y_index * 20);
         x_direct = x_index * 20;
         y_direct = y_index * 20;
@@ -145,6 +175,7 @@ void drawMap(const char *maze, int widthScreen, int heightScreen) {
 
 
 void draw_wall(int x, int y) {
+    STAT_INC(fb_stats.blits);
     for (int j = 0; j < 20; j++) {
         for (int i = 0; i < 20; i++) {
             drawPixelARGB32(i + x, j + y, epd_bitmap_wall[j*20 +i]);
@@ -153,6 +184,7 @@ void draw_wall(int x, int y) {
 }
 
 void draw_destination(int x, int y) {
+    STAT_INC(fb_stats.blits);
     for (int j = 0; j < 20; j++) {
         for (int i = 0; i < 21; i++) {
             drawPixelARGB32(i + x, j + y, epd_bitmap_destination[j*21 +i]);
@@ -160,22 +192,30 @@ void draw_destination(int x, int y) {
     }
 }
 
-void draw_video() {
+static task *video_task = NULL;
+
+// Video player task, started by the video command
+void draw_video(void *ctx) {
+    // 25 frames per second, paced by absolute deadlines rather than by drawing time
+    unsigned long next_frame = timer_ms();
+
+    perf_boost();
     for (int a = 0; a < epd_bitmap_allArray_LEN; a++) {
+        next_frame += 40;
+        task_sleep_until(next_frame);
+        perf_poll();
+        PROF_SCOPE("video_frame");
+        STAT_INC(fb_stats.blits);
         for (int j = 0; j < 240; j++) {
             for (int i = 0; i < 426; i++) {
                 drawPixelARGB32(i, j, epd_bitmap_allArray[a][j * 426 + i]);
             }
         }
-        wait_msec(40000);
     }
+    perf_release();
+    video_task = NULL;
 }
 
-const char *commands[] = {
-    "help", "clear", "setcolor", "showinfo", "video", "smallimg", "game"
-    // Add more commands as needed
-};
-
 char *strcpy(char *dest, const char *src) {
     char *originalDest = dest;
     
@@ -271,62 +311,15 @@ int strcmp(const char* str1, const char* str2) {
     }
 }
 
-void help_command(const char *cmd) {
-    // Implement help command logic here
-    // Print the information about the supported commands
-    // ...
-    uart_puts("Available commands:\n");
-    uart_puts("For more information on a specific command, type help <command-name>:\n");
-    uart_puts("help                                 Show brief information of all commands\n");
-    uart_puts("help <command_name>                  Show full information of the command\n");
-    uart_puts("clear                                Clear screen\n");
-    uart_puts("setcolor                             Set text color, and/or background color of the console to one of the following colors: BLACK, RED, GREEN, YELLOW, BLUE, PURPLE, CYAN, WHITE\n");
-    uart_puts("showinfo                             Show board revision and board MAC address\n");
-}
-
-void help_info(const char *cmd){
-    if (strcmp(cmd, "setcolor") == 0) {
-        uart_puts("Set text color only:                         setcolor -t <color>.\n");
-        uart_puts("Set background color only:                   setcolor -b <color>.\n");
-        uart_puts("Set color for both background and text:      setcolor -t <color> -b <color or setcolor -b <color> -t<color>.\n");
-        uart_puts("Accepted color and writing format:  Black,  Red, Green, Yellow, Blue, Purple, Cyan, White.\n");
-        uart_puts("Examples\nMyBareMetalOS> setcolor -t yellow\nMyBareMetalOS> setcolor -b yellow -t white\n");
-    } else if (strcmp(cmd, "clear") == 0) {
-        uart_puts("Clear screen (in our terminal it will scroll down to current position of the cursor).\n");
-        uart_puts("Example: MyBareMetalOS> clear\n");
-    } else if (strcmp(cmd, "showinfo") == 0) {
-        uart_puts("Show board revision and board MAC address in correct format/ meaningful information.\n");
-        uart_puts("Example: MyBareMetalOS> showinfo\n");
-    } else {
-        uart_puts("Unrecognized command\n");
-    } 
-}
-
 void showinfo() {
-    mBuf[0] = 11*4; // Message Buffer Size in bytes (8 elements * 4 bytes (32 bit) each)
-    mBuf[1] = MBOX_REQUEST; // Message Request Code (this is a request message)
+    const board_props *p = props_get();
 
-    mBuf[2] = 0x00010002; // TAG Identifier: Get Board Revision
-    mBuf[3] = 4; // Value buffer size in bytes (max of request and response lengths)
-    mBuf[4] = 0; // REQUEST CODE = 0
-    mBuf[5] = 0; // clear output buffer (response data are mBuf[10])
-    
-    mBuf[6] = 0x00010003; // TAG Identifier: Get Board Mac Address 
-    mBuf[7] = 6; // Value buffer size in bytes (max of request and response lengths)
-    mBuf[8] = 0; // REQUEST CODE = 0
-    mBuf[9] = 0; // clear output buffer (response data are mBuf[9])
-    mBuf[10] = 0; 
-    mBuf[11] = MBOX_TAG_LAST;
-
-    if (mbox_call(ADDR(mBuf), MBOX_CH_PROP)) {
+    if (p->valid) {
         uart_puts("\nDATA: Board Revision = ");
-        uart_hex(mBuf[5]);
+        uart_hex(p->revision);
         uart_puts("\nBoard MAC Address: ");
-        //printf("%x", mBuf[10]);
-        // printf("%x", mBuf[9]);
         printf("%02x:%02x:%02x:%02x:%02x:%02x",
-        (mBuf[10] >> 8) & 0xFF, mBuf[10] & 0xFF,(mBuf[9] >> 24) & 0xFF,
-        (mBuf[9] >> 16) & 0xFF, (mBuf[9] >> 8) & 0xFF, mBuf[9] & 0xFF);
+        p->mac[0], p->mac[1], p->mac[2], p->mac[3], p->mac[4], p->mac[5]);
         uart_puts("\n");
     } else {
         uart_puts("Unable to query!\n");
@@ -349,14 +342,6 @@ void clear_command() {
     uart_puts("\x1B[2J\x1B[H");
 }
 
-void deleteCommand(char *cmd_buffer, int *index) {
-    if (*index > 0) {
-        (*index)--;
-        cmd_buffer[*index] = '\0';
-        uart_puts("\b \b"); // Move the cursor back, write a space to clear the character, and move the cursor back again
-    } 
-}
-
 char *strcat(char *dest, const char *src) {
     char *originalDest = dest;
 
@@ -444,288 +429,627 @@ void *memset(void *ptr, int value, size_t num) {
     return ptr;
 }
 
-// Function to perform auto-completion
-void autocomplete(char *cmd_buffer, int *cmd_index) {
-    int matches = 0;
-    int match_index = -1;
-    for (int i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
-        if (strncmp(commands[i], cmd_buffer, *cmd_index) == 0) {
-            matches++;
-            match_index = i;
+void *memcpy(void *dest, const void *src, size_t num) {
+    unsigned char *d = (unsigned char *)dest;
+    const unsigned char *s = (const unsigned char *)src;
+
+    for (size_t i = 0; i < num; i++) {
+        d[i] = s[i];
+    }
+
+    return dest;
+}
+
+void clear_frame(int x, int y, int heightScreen, int widthScreen) {
+    for (int j = 0; j < heightScreen; j++) {
+        for (int i = 0; i < widthScreen; i++){
+            drawPixelARGB32(i + x,j + y, 0x00000000);
         }
     }
+}
 
-    if (matches == 1) {
-        strcpy(cmd_buffer, commands[match_index]);
-        *cmd_index = strlen(commands[match_index]);
-        uart_puts("\r");
-        uart_puts("\nMyBareMetalOS> ");  // Print the prompt
-        uart_puts(cmd_buffer);
-    } else if (matches > 1) {
-        uart_puts("\nPossible completions:");
-        for (int i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
-            if (strncmp(commands[i], cmd_buffer, *cmd_index) == 0) {
-                uart_puts(" ");
-                uart_puts((char *)commands[i]);
-            }
+/* Game loop state: keys polled but not simulated yet, with their arrival
+   time, and what the last rendered frame shows */
+static struct {
+    char key[GAME_INPUT_QUEUE];
+    unsigned long at[GAME_INPUT_QUEUE];  // counter when the key was polled
+    unsigned int head, tail;
+    unsigned long consumed[GAME_MAX_CATCHUP]; // arrival of the keys simulated this frame
+    int nconsumed;
+    int drawn_x, drawn_y;                // player position on screen
+    int quit;                            // ended, the task returns at its next step
+    task *task;                          // NULL once the task has returned
+} game;
+
+/* Frame statistics, shown in the HUD once per second */
+static struct {
+    unsigned long start, window_start;
+    unsigned int frames;
+    unsigned long frame_sum, frame_max;  // update + render time, ns
+    unsigned long input_last, input_max; // key polled to frame presented, ns
+    unsigned long steps, dropped;
+    unsigned int fps;
+    unsigned long frame_avg, frame_peak, input_peak;
+} game_hud;
+
+/* Hint overlay: a dot on each square of the shortest path from the
+   player to the destination, redrawn when the player moves */
+static struct {
+    int square[HINT_MAX];
+    int len;        // squares of the path on screen, 0 when none
+    int on, dirty;
+} hint;
+
+static prof_hist game_frame_hist = { .name = "game_frame" };
+static prof_hist game_input_hist = { .name = "game_input" };
+
+// Queue every received key without waiting for more
+static void game_poll_input() {
+    while (uart_rx_ready()) {
+        char c = uart_getc();
+        if (game.tail - game.head < GAME_INPUT_QUEUE) {
+            game.key[game.tail % GAME_INPUT_QUEUE] = c;
+            game.at[game.tail % GAME_INPUT_QUEUE] = now_cycles();
+            game.tail++;
         }
-        uart_puts("\n");
-        *cmd_index = 0;
-        uart_puts("MyBareMetalOS> ");
-        memset(cmd_buffer, '\0', MAX_CMD_SIZE);
-    } else {
-        uart_puts("\nNo suggestions found.\n");
-        uart_puts("MyBareMetalOS> ");
-        uart_puts(cmd_buffer);
     }
 }
 
-void add_to_history(const char *cmd) {
-    if (history_count < HISTORY_SIZE) {
-        strcpy(history[history_count], cmd);
-        history_count++;
+/*
+* End the game: the shell gets the keyboard back right away and the maze
+* stays on screen (and in maze) for the hint command
+*/
+static void game_end() {
+    if (!inGame)
+        return;
+    game.quit = 1;
+    inGame = 0;
+    perf_release();
+}
+
+// One fixed simulation step: the player moves at most one cell (w/a/s/d), q ends the game
+static void game_update() {
+    game_hud.steps++;
+    if (game.head == game.tail)
+        return;
+    char c = game.key[game.head % GAME_INPUT_QUEUE];
+    game.consumed[game.nconsumed++] = game.at[game.head % GAME_INPUT_QUEUE];
+    game.head++;
+
+    if (c == 'w' && checkDirection(3) == 1) {
+        y_direct -= 20;
+    } else if (c == 'a' && checkDirection(6) == 1) {
+        x_direct -= 20;
+    } else if (c == 's' && checkDirection(5) == 1) {
+        y_direct += 20;
+    } else if (c == 'd' && checkDirection(4) == 1) {
+        x_direct += 20;
+    } else if (c == 'h') {
+        hint.on = !hint.on;
+        hint.dirty = 1;
+        return;
+    } else if (c == 'q') {
+        game_end();
+        uart_puts("\nGame over, the maze stays for hint\n");
+        line_prompt();
+        return;
     } else {
-        history_count = 0;
+        return;
     }
+    hint.dirty = hint.on;
+    getNearFrontier(&maze, x_direct / 20, y_direct / 20);
 }
 
-void play_game() {
-    maze = (char*)malloc(widthScreen * heightScreen * sizeof(char));
-    if (maze == NULL) {
-        printf("Not enough memory, the game cant be generated!");
+static void draw_hint_dot(int square, unsigned int color) {
+    int x = square % maze.width * 20, y = square / maze.width * 20;
+    STAT_INC(fb_stats.blits);
+    drawRectARGB32(x + 7, y + 7, x + 12, y + 12, color, 1);
+}
+
+static int player_square() {
+    return y_direct / 20 * maze.width + x_direct / 20;
+}
+
+// Erase the dots on screen and, when the hint is on, draw the path from where the player is now
+static void hint_render() {
+    int player = player_square();
+    path_result r;
+
+    // the ends are the player and the destination tiles, not dots
+    for (int i = 1; i < hint.len - 1; i++) {
+        if (hint.square[i] != player)
+            draw_hint_dot(hint.square[i], 0x00000000);
     }
-    else {
-        GenerateMaze(maze, widthScreen, heightScreen);
-        ShowMaze(maze, widthScreen, heightScreen);
-        drawMap(maze, widthScreen, heightScreen);
-        inGame = 1;
+    hint.len = 0;
+    if (hint.on && path_jps(&maze, player, maze.goal, hint.square, HINT_MAX, &r) && r.length <= HINT_MAX) {
+        hint.len = r.length;
+        for (int i = 1; i < hint.len - 1; i++)
+            draw_hint_dot(hint.square[i], HINT_COLOR);
     }
+    hint.dirty = 0;
 }
 
-void clear_frame(int heightScreen, int widthScreen) {
-    for (int j = 0; j < heightScreen; j++) {
-        for (int i = 0; i < widthScreen; i++){
-            drawPixelARGB32(i + x_direct,j + y_direct, 0x00000000);
-        }
+static void game_draw_hud() {
+    fb_cursor cursor = { 0, (heightScreen + 1) * 20 + 8, 0, 0x0F };
+    unsigned long elapsed = cycles_to_ns(now_cycles() - game_hud.start) / 1000000000;
+
+    fb_printf(&cursor, "time %3lu:%02lu  fps %3u  frame avg %5lu us max %5lu us  input %5lu us max %5lu us  dropped %lu ",
+              elapsed / 60, elapsed % 60, game_hud.fps, game_hud.frame_avg / 1000,
+              game_hud.frame_peak / 1000, game_hud.input_last / 1000,
+              game_hud.input_peak / 1000, game_hud.dropped);
+}
+
+// Draw what changed since the last frame, then the HUD
+static void game_render() {
+    if (game.drawn_x != x_direct || game.drawn_y != y_direct) {
+        clear_frame(game.drawn_x, game.drawn_y, 20, 21);
+        draw_destination(x_direct, y_direct);
+        game.drawn_x = x_direct;
+        game.drawn_y = y_direct;
     }
+    if (hint.dirty)
+        hint_render();
+    game_draw_hud();
 }
-void cli()
-{
-	static char cli_buffer[MAX_CMD_SIZE];
-	static int index = 0;
 
-	//read and send back each char
-	char c = uart_getc();
+static void game_frame_done(unsigned long start) {
+    unsigned long presented = now_cycles();
+    unsigned long frame_ns = cycles_to_ns(presented - start);
+
+    prof_record(&game_frame_hist, frame_ns);
+    STAT_INC(game_stats.frames);
+    game_hud.frames++;
+    game_hud.frame_sum += frame_ns;
+    if (frame_ns > game_hud.frame_max)
+        game_hud.frame_max = frame_ns;
+
+    for (int i = 0; i < game.nconsumed; i++) {
+        unsigned long latency = cycles_to_ns(presented - game.consumed[i]);
+        prof_record(&game_input_hist, latency);
+        game_hud.input_last = latency;
+        if (latency > game_hud.input_max)
+            game_hud.input_max = latency;
+    }
+    game.nconsumed = 0;
+
+    // roll the HUD numbers over every second
+    if (presented - game_hud.window_start >= clock_freq) {
+        game_hud.fps = game_hud.frames;
+        game_hud.frame_avg = game_hud.frame_sum / game_hud.frames;
+        game_hud.frame_peak = game_hud.frame_max;
+        game_hud.input_peak = game_hud.input_max;
+        game_hud.frames = 0;
+        game_hud.frame_sum = game_hud.frame_max = game_hud.input_max = 0;
+        game_hud.window_start = presented;
+    }
+}
 
-    if (inGame == 1) {
-        if (c == 'w') {
-            if (checkDirection(3) == 1) {
-            clear_frame(20, 21);
-            y_direct -= 20;
-            }
-        }
-        else if (c == 'a') {
-            if (checkDirection(6) == 1) {
-            clear_frame(20, 21);
-            x_direct -= 20;
-            }
+/*
+* Game task: polls the input without blocking, steps the simulation at
+* GAME_HZ from an accumulator of elapsed time (catching up after a late
+* frame) and renders once per frame in which a step ran
+*/
+void game_task(void *ctx) {
+    unsigned long step = us_to_cycles(GAME_STEP_US);
+    unsigned long last = now_cycles();
+    unsigned long acc = 0;
+
+    game.drawn_x = x_direct;
+    game.drawn_y = y_direct;
+    game_hud.start = game_hud.window_start = last;
+
+    while (!game.quit) {
+        unsigned long now = now_cycles();
+        game_poll_input();
+
+        acc += now - last;
+        last = now;
+        if (acc > GAME_MAX_CATCHUP * step) {
+            // stalled (e.g. by a long command): skip ahead rather than spiral
+            game_hud.dropped += acc / step - GAME_MAX_CATCHUP;
+            acc = GAME_MAX_CATCHUP * step;
         }
-        else if (c == 's') {
-            if (checkDirection(5) == 1) {
-            clear_frame(20, 21);
-            y_direct += 20;
-            }
+
+        int steps = 0;
+        while (acc >= step) {
+            game_update();
+            acc -= step;
+            steps++;
         }
-        else if (c == 'd') {
-            if (checkDirection(4) == 1) {
-            clear_frame(20, 21);
-            x_direct += 20;
-            }
+        if (steps > 0) {
+            game_render();
+            game_frame_done(now);
         }
-        getNearFrontier(maze, x_direct / 20, y_direct / 20);
-        draw_destination(x_direct, y_direct);
+        perf_poll();
+
+        // sleep until the next step is due
+        unsigned long wait_us = cycles_to_ns(step - acc) / 1000;
+        task_sleep_until(timer_ms() + (wait_us + 999) / 1000);
+    }
+    game.task = NULL;
+}
+
+void play_game(const maze_generator *gen) {
+    if (game.task != NULL) {
+        printf(inGame ? "A game is already running\n" : "The last game is still ending, try again\n");
         return;
     }
-	uart_sendc(c);
-
-
-	//put into a buffer until got new line character
-    if (c == 127){
-        deleteCommand(cli_buffer, &index);
-    } else if (c != '\n' && c !='\t'){
-		cli_buffer[index] = c; //Store into the buffer
-		index++;
-	} else if (c == '\n'){
-		cli_buffer[index] = '\0';
-		uart_puts("\nGot commands: ");
-		uart_puts(cli_buffer); uart_puts("\n");
-        add_to_history(cli_buffer);
-        current_history_index = history_count; //Set the index for history browsing
-		/* Compare with supported commands and execute
-		* ........................................... */
-        char* tokens[MAX_TOKENS]; // Array to store tokens
-        char *token;
-        char *saveptr = NULL;
-
-        token = strtok(cli_buffer, " ", &saveptr);
-        int numTokens = 0;
-
-        while (token != NULL && numTokens < MAX_TOKENS) {
-            tokens[numTokens] = token;
-            numTokens++;
-            token = strtok(NULL, " ", &saveptr);
+    uint64_t *bits = (uint64_t*)malloc(MAZE_BYTES(widthScreen, heightScreen));
+    maze_map_init(&maze, bits, widthScreen, heightScreen);
+    if (bits == NULL || !gen->generate(&maze)) {
+        printf("Not enough memory, the game cant be generated!");
+    }
+    else {
+        ShowMaze(&maze);
+        drawMap(&maze);
+        game.quit = 0;
+        game.head = game.tail = 0;
+        hint.on = hint.len = 0;
+        game.task = task_create("game", game_task, NULL, SCHED_PRIO_NORMAL);
+        if (game.task == NULL) {
+            printf("No free task for the game!\n");
+            return;
         }
+        inGame = 1;
+        perf_boost(); // released by game_end()
+    }
+}
 
-        if (numTokens > 0 && strcmp(tokens[0], "help") == 0) {
-            if (numTokens == 1){
-                help_command(cli_buffer);
-            }else if (numTokens == 2){
-                help_info(tokens[1]);
-            } else {
-                uart_puts("Unrecognized command: \n");
-            }
-        } else if (strcmp(tokens[0], "clear") == 0) {
-            // Handle clear command
-            clear_command();
-        } else if (strcmp(tokens[0], "video") == 0) {
-            draw_video();
-        } else if (strcmp(tokens[0], "smallimg") == 0) {
-            draw_image();
-        } else if (strcmp(tokens[0], "game") == 0) {
-            play_game();
-        }
-         else if (strcmp(tokens[0], "setcolor") == 0) {
-            // Handle setcolor command
-            if (numTokens == 1) {
-            // Print usage information
-            uart_puts("Set text color only:         setcolor -t <color>.\n");
-            uart_puts("Set background color only:   setcolor -b <color>.\n");
-            uart_puts("Set color for both:          setcolor -t <color> -b <color>.\n");
-            uart_puts("Accepted colors: Black, Red, Green, Yellow, Blue, Purple, Cyan, White.\n");
-            } else if (numTokens == 3 && strcmp(tokens[1], "-t") == 0) {
-                // Handle setcolor -t <color>
-                setTextColor(tokens[2]);
-            } else if (numTokens == 3 && strcmp(tokens[1], "-b") == 0) {
-                // Handle setcolor -b <color>
-                // ...
-                setBackGroundColor(tokens[2]);
-            } else if (numTokens == 5 &&  (strcmp(tokens[1], "-t") == 0 && strcmp(tokens[3], "-b") == 0)) {
-                // Handle setcolor -t <color> -b <color>
-                // ...
-                setTextColor (tokens[2]);
-                setBackGroundColor(tokens[4]);
-            } else if (numTokens == 5 && (strcmp(tokens[1], "-b") == 0 && strcmp(tokens[3], "-t") == 0)){
-                // Handle setcolor -B <color> -t <color>
-                setTextColor (tokens[4]);
-                setBackGroundColor(tokens[2]);
-            } else {
-                // Invalid usage
-                uart_puts("Invalid usage. Use 'help setcolor' for usage information.\n");
-            }
-        } else if (strcmp(tokens[0], "showinfo") == 0) {
-            // Handle showinfo command
-            showinfo();
-        } else {
-            // Handle unrecognized command
-            uart_puts("Unrecognized command: \n");
-        }
+/* ----------------------------------- commands ------------------------------------- */
 
-		//Return to command line
-		index = 0;
+static void do_help(int argc, char **argv) {
+    if (argc == 1) {
+        printf("Available commands:\n");
+        printf("For more information on a specific command, type help <command-name>:\n");
+        cmd_print_summary();
+    } else if (!cmd_print_help(argv[1])) {
+        uart_puts("Unrecognized command\n");
+    }
+}
 
-        uart_puts("MyBareMetalOS> ");
-	} else if (c == '\t') {
-        cli_buffer[index] = '\0';
-        autocomplete(cli_buffer, &index);
-    } 
+static void do_clear(int argc, char **argv) {
+    clear_command();
+}
 
-    if (c == '+') { // Use '_' as UP arrow
-        if (current_history_index < history_count) {
-            current_history_index++;
-        }
-        if (current_history_index >= history_count) {
-            current_history_index = 0;
-        }
-        memset(cli_buffer, '\0', MAX_CMD_SIZE);
-        strcpy(cli_buffer, history[current_history_index]);
-        index = strlen(cli_buffer);
+static void do_setcolor(int argc, char **argv) {
+    if (argc == 1) {
+        // Print usage information
+        uart_puts("Set text color only:         setcolor -t <color>.\n");
+        uart_puts("Set background color only:   setcolor -b <color>.\n");
+        uart_puts("Set color for both:          setcolor -t <color> -b <color>.\n");
+        uart_puts("Accepted colors: Black, Red, Green, Yellow, Blue, Purple, Cyan, White.\n");
+    } else if (argc == 3 && strcmp(argv[1], "-t") == 0) {
+        // Handle setcolor -t <color>
+        setTextColor(argv[2]);
+    } else if (argc == 3 && strcmp(argv[1], "-b") == 0) {
+        // Handle setcolor -b <color>
+        setBackGroundColor(argv[2]);
+    } else if (argc == 5 && (strcmp(argv[1], "-t") == 0 && strcmp(argv[3], "-b") == 0)) {
+        // Handle setcolor -t <color> -b <color>
+        setTextColor(argv[2]);
+        setBackGroundColor(argv[4]);
+    } else if (argc == 5 && (strcmp(argv[1], "-b") == 0 && strcmp(argv[3], "-t") == 0)) {
+        // Handle setcolor -b <color> -t <color>
+        setTextColor(argv[4]);
+        setBackGroundColor(argv[2]);
+    } else {
+        // Invalid usage
+        uart_puts("Invalid usage. Use 'help setcolor' for usage information.\n");
+    }
+}
+
+static void do_showinfo(int argc, char **argv) {
+    showinfo();
+}
+
+static void do_video(int argc, char **argv) {
+    // plays in its own task, the prompt comes back right away
+    if (video_task != NULL) {
+        uart_puts("The video is already playing\n");
+    } else {
+        video_task = task_create("video", draw_video, NULL, SCHED_PRIO_NORMAL);
+        if (video_task == NULL)
+            uart_puts("No free task for the video!\n");
+    }
+}
+
+static void do_smallimg(int argc, char **argv) {
+    draw_image();
+}
+
+static void do_game(int argc, char **argv) {
+    const maze_generator *gen = &maze_generators[0];
+
+    if (argc == 2 && strcmp(argv[1], "list") == 0) {
+        for (int i = 0; i < maze_generator_count; i++)
+            printf("%-10s %s\n", maze_generators[i].name, maze_generators[i].summary);
+        return;
+    }
+    if (argc == 2 && strcmp(argv[1], "quit") == 0) {
+        if (!inGame)
+            printf("game: no game running\n");
+        game_end();
+        return;
+    }
+    if (argc == 2 && (gen = FindMazeGenerator(argv[1])) == NULL) {
+        printf("game: no algorithm named %s, see game list\n", argv[1]);
+        return;
+    }
+    play_game(gen);
+}
 
-        uart_puts("\r");
-        uart_puts("\x1B[K");
-        uart_puts("MyBareMetalOS> ");
-        uart_puts(cli_buffer);
+static void do_hint(int argc, char **argv) {
+    int jps = argc == 1 || strcmp(argv[1], "jps") == 0;
+    path_result r;
+
+    if (argc == 2 && !jps && strcmp(argv[1], "astar") != 0) {
+        printf("Usage: hint [astar|jps]\n");
+        return;
+    }
+    if (maze.bits == NULL) {
+        printf("hint: no maze yet, start one with game\n");
+        return;
+    }
+    unsigned long start = now_cycles();
+    int found = (jps ? path_jps : path_astar)(&maze, player_square(), maze.goal, NULL, 0, &r);
+    unsigned long us = cycles_to_ns(now_cycles() - start) / 1000;
+    if (!found) {
+        printf("hint: no path to the destination\n");
+        return;
     }
+    printf("%s: %d squares to the destination, %lu nodes expanded in %lu us\n",
+           jps ? "jps" : "astar", r.length - 1, r.expanded, us);
+    // draw now: after the game no task is left to render it
+    hint.on = 1;
+    hint_render();
+}
+
+static void do_maze(int argc, char **argv) {
+    unsigned long size[2] = { 0, 0 };
 
-    if (c == '_') { // Use '+' as DOWN arrow
-        if (current_history_index == 0) {
-            current_history_index = history_count;
+    for (int i = 0; i < 2; i++) {
+        const char *p = argv[i + 1];
+        for (; *p >= '0' && *p <= '9' && size[i] < 1000000000UL; p++)
+            size[i] = size[i] * 10 + (*p - '0');
+        if (*p || size[i] == 0 || size[0] > MAZE_STREAM_MAX_WIDTH) {
+            printf("maze: bad size %s\n", argv[i + 1]);
+            return;
         }
-        current_history_index --;
-        memset(cli_buffer, '\0', MAX_CMD_SIZE);
-        strcpy(cli_buffer, history[current_history_index]);
-        index = strlen(cli_buffer);
+    }
+    if (!ShowMazeStream(size[0], size[1]))
+        printf("Not enough memory, the maze cant be generated!\n");
+}
 
-        uart_puts("\r"); // Move cursor to the beginning of the line
-        uart_puts("\x1B[K"); // Clear the line
-        uart_puts("MyBareMetalOS> ");   
-        uart_puts(cli_buffer);
+static void do_log(int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "clear") == 0) {
+        log_clear();
+    } else {
+        log_drain();
+        uart_puts("\n");
     }
 }
 
-void mbox_buffer_setup(unsigned int buffer_addr, unsigned int tag_identifier,
-                       unsigned int **res_data, unsigned int res_length,
-                       unsigned int req_length, ...);
+static void do_bench(int argc, char **argv) {
+    int machine = argc > 1 && strcmp(argv[1], "-m") == 0;
 
-void getBoardRevision(){
-    unsigned int *revision = 0;
-    mbox_buffer_setup(ADDR(mBuf), 0x00010002, &revision, 4, 0, 0);
-    mbox_call(ADDR(mBuf), MBOX_CH_PROP);
-    uart_puts("Board revision: ");
-    uart_hex(revision[0]);
-    uart_puts("\n");
+    perf_boost();
+    bench_command(argv + 1 + machine, argc - 1 - machine, machine);
+    perf_release();
 }
 
-void getfirmwareRevision(){
-    unsigned int *firmware = 0;
-    mbox_buffer_setup(ADDR(mBuf), 0x00000001, &firmware, 4, 0, 0);
-    mbox_call(ADDR(mBuf), MBOX_CH_PROP);
-    uart_puts("Firmware revision: ");
-    uart_hex(firmware[0]);
+static void do_screenshot(int argc, char **argv) {
+    screenshot_send(argc == 2 && strcmp(argv[1], "diff") == 0);
     uart_puts("\n");
 }
 
-void getUARTclockrate(){
-    unsigned int *UART_clockrate = 0;
-    mbox_buffer_setup(ADDR(mBuf), 0x00030002, &UART_clockrate, 8, 4, 2);
-    mbox_call(ADDR(mBuf), MBOX_CH_PROP);
-    uart_puts("UART clock rate = ");
-    uart_dec(UART_clockrate[1]);
-    uart_puts("\n");
+static void do_perf(int argc, char **argv) {
+    perf_command(argc > 1 ? argv[1] : NULL);
 }
 
-void getARMclockrate(){
-    unsigned int *ARM_clockrate = 0;
-    mbox_buffer_setup(ADDR(mBuf), 0x00030002, &ARM_clockrate, 8, 4, 3);
-    mbox_call(ADDR(mBuf), MBOX_CH_PROP);
-    uart_puts("ARM clock rate = ");
-    uart_dec(ARM_clockrate[1]);
-    uart_puts("\n");
+static void do_prof(int argc, char **argv) {
+    prof_command(argc > 1 ? argv[1] : NULL);
+}
+
+static void do_tasks(int argc, char **argv) {
+    sched_command();
+}
+
+static void do_stats(int argc, char **argv) {
+    stats_command(argc, argv);
+}
+
+static void do_script(int argc, char **argv) {
+    script_command(argc > 1 ? argv[1] : NULL);
+}
+
+/* ----------------------------------- benchmarks ------------------------------------- */
+
+static uint64_t bench_map_bits[MAZE_ROW_WORDS(40) * 20];
+static maze_map bench_map;
+static int bench_map_ready = 0;
+
+static void bench_sprite_blit(unsigned int iters) {
+    for (unsigned int i = 0; i < iters; i++)
+        draw_wall((i % 40) * 20, 0);
+}
+
+static void bench_map_draw(unsigned int iters) {
+    if (!bench_map_ready) {
+        maze_map_init(&bench_map, bench_map_bits, 40, 20);
+        GenerateMaze(&bench_map);
+        bench_map_ready = 1;
+    }
+    for (unsigned int i = 0; i < iters; i++)
+        drawMazeCells(&bench_map);
+}
+
+static const bench_case game_benches[] = {
+    {"sprite_blit", bench_sprite_blit, 200, 20 * 20, "px"},
+    {"map_draw",    bench_map_draw,    4,   40 * 20, "cells"},
+};
+
+static const cmd commands[] = {
+    { "help", do_help, 0, 1, "help [command_name]",
+      "Show brief information of all commands, or full information of one",
+      "Without argument, list all commands; with a command name, show its full information.\n"
+      "Examples\nMyBareMetalOS> help\nMyBareMetalOS> help setcolor\n" },
+    { "clear", do_clear, 0, 0, "clear", "Clear screen",
+      "Clear screen (in our terminal it will scroll down to current position of the cursor).\n"
+      "Example: MyBareMetalOS> clear\n" },
+    { "setcolor", do_setcolor, 0, 4, "setcolor [-t <color>] [-b <color>]",
+      "Set text color, and/or background color of the console to one of the following colors: BLACK, RED, GREEN, YELLOW, BLUE, PURPLE, CYAN, WHITE",
+      "Set text color only:                         setcolor -t <color>.\n"
+      "Set background color only:                   setcolor -b <color>.\n"
+      "Set color for both background and text:      setcolor -t <color> -b <color or setcolor -b <color> -t<color>.\n"
+      "Accepted color and writing format:  Black,  Red, Green, Yellow, Blue, Purple, Cyan, White.\n"
+      "Examples\nMyBareMetalOS> setcolor -t yellow\nMyBareMetalOS> setcolor -b yellow -t white\n" },
+    { "showinfo", do_showinfo, 0, 0, "showinfo", "Show board revision and board MAC address",
+      "Show board revision and board MAC address in correct format/ meaningful information.\n"
+      "Example: MyBareMetalOS> showinfo\n" },
+    { "video", do_video, 0, 0, "video", "Play the video on the screen (in the background)",
+      "Play the video at 25 frames per second in its own task; the prompt stays usable meanwhile.\n"
+      "Example: MyBareMetalOS> video\n" },
+    { "smallimg", do_smallimg, 0, 0, "smallimg", "Draw the small image on the screen",
+      "Draw the small image in the top left corner of the screen.\n"
+      "Example: MyBareMetalOS> smallimg\n" },
+    { "game", do_game, 0, 1, "game [algorithm|list|quit]", "Play the maze game",
+      "Generate a maze and play it with w/a/s/d. The game keeps the keyboard until q ends it (or game quit\n"
+      "from a script); the maze stays on screen for the hint command.\n"
+      "a line under the maze shows fps, frame time and input latency.\n"
+      "The maze is made with randomized Prim unless another algorithm is named; game list shows them.\n"
+      "h shows or hides the shortest path to the destination.\n"
+      "Examples\nMyBareMetalOS> game\nMyBareMetalOS> game wilson\nMyBareMetalOS> game list\n" },
+    { "hint", do_hint, 0, 1, "hint [astar|jps]", "Solve the game maze and show the path",
+      "Find the shortest path from the player to the destination with A* or jump point search (the\n"
+      "default), print its length and the nodes expanded, and draw it over the maze like the h key.\n"
+      "Run it once the game has ended with q, on the maze left on screen.\n"
+      "Examples\nMyBareMetalOS> hint\nMyBareMetalOS> hint astar\n" },
+    { "maze", do_maze, 2, 2, "maze <width> <height>", "Print a maze of any height on the serial line",
+      "Print a maze of width x height squares, made with Eller's algorithm while it is sent: memory\n"
+      "only grows with the width (at most 2000), so the height can be as large as wanted.\n"
+      "Any key stops it.\n"
+      "Example: MyBareMetalOS> maze 41 1000\n" },
+    { "log", do_log, 0, 1, "log [clear]",
+      "Send buffered binary log records (decode with tools/logdecode.py)",
+      "Send the buffered LOG() records as binary frames, or drop them.\n"
+      "Capture the serial output and decode it with: tools/logdecode.py object/kernel8.elf capture.bin\n"
+      "Examples\nMyBareMetalOS> log\nMyBareMetalOS> log clear\n" },
+    { "bench", do_bench, 0, CMD_MAX_ARGS - 1, "bench [-m] [name...]",
+      "Run the microbenchmarks (or those starting with one of the names)",
+      "Time the microbenchmarks (formatting, memset/memcpy, pixels, sprites, map, maze generation,\n"
+      "pathfinding, UART, mailbox) over 11 samples and print the median and p90 ns per iteration,\n"
+      "cycles per iteration and throughput. Names select the cases whose name starts with any of them;\n"
+      "-m prints one CSV line per case instead, for tracking regressions.\n"
+      "Examples\nMyBareMetalOS> bench\nMyBareMetalOS> bench maze path\nMyBareMetalOS> bench -m dist\n" },
+    { "screenshot", do_screenshot, 0, 1, "screenshot [diff]",
+      "Send the screen compressed (decode with tools/screenshot.py)",
+      "Send the framebuffer as QOI-compressed tiles with a CRC.\n"
+      "With diff only the tiles drawn since the previous screenshot are sent, to record frame sequences.\n"
+      "Capture the serial output and rebuild PNGs with: tools/screenshot.py capture.bin\n"
+      "Examples\nMyBareMetalOS> screenshot\nMyBareMetalOS> screenshot diff\n" },
+    { "perf", do_perf, 0, 1, "perf [auto|max|min]", "Show or set the ARM clock governor",
+      "Show clock rates and SoC temperature, or set the governor mode:\n"
+      "auto: maximum ARM clock while video, game or bench run, minimum otherwise (default).\n"
+      "max/min: always the maximum/minimum ARM clock.\n"
+      "Close to the throttling temperature the governor drops to the minimum until it cools down.\n"
+      "Examples\nMyBareMetalOS> perf\nMyBareMetalOS> perf max\n" },
+    { "prof", do_prof, 0, 1, "prof [name|reset]", "Show the profiling histograms",
+      "Show count, min, average, p50/p90/p99 and max (ns) of every PROF_SCOPE histogram.\n"
+      "With a histogram name, show its buckets; with reset, clear all samples.\n"
+      "Examples\nMyBareMetalOS> prof\nMyBareMetalOS> prof video_frame\nMyBareMetalOS> prof reset\n" },
+    { "tasks", do_tasks, 0, 0, "tasks", "Show the scheduler tasks and context switch statistics",
+      "List the tasks (shell, video, game) with their priority, state, context switches and running time,\n"
+      "then the total number of context switches and the switch latency.\n"
+      "Example: MyBareMetalOS> tasks\n" },
+    { "script", do_script, 0, 1, "script [name|list]", "Run a pasted or built-in command script",
+      "Without argument, read a pasted script (one command per line, # for comments) and run it;\n"
+      "end the paste with Ctrl-D or a line holding only '.'. With a name, run that built-in script;\n"
+      "list shows them. Commands run back to back with batched output, then the total time is shown.\n"
+      "Examples\nMyBareMetalOS> script\nMyBareMetalOS> script selftest\n" },
+    { "stats", do_stats, 0, 2, "stats [reset|rate [ms]]", "Show or reset the runtime counters",
+      "Show the counters of the framebuffer (pixels, blits), UART (bytes sent and received),\n"
+      "mailbox (messages, wait time in counter ticks), heaps (bytes allocated and live) and game (frames).\n"
+      "reset zeroes them; rate prints their per second rates every ms milliseconds (default 1000)\n"
+      "until a key is pressed.\n"
+      "Examples\nMyBareMetalOS> stats\nMyBareMetalOS> stats reset\nMyBareMetalOS> stats rate 500\n" },
+};
+
+void cli()
+{
+    // edit the line until Enter, echoing through the line editor
+    char *line = line_feed(uart_getc());
+    if (line == NULL)
+        return;
+
+    uart_puts("Got commands: ");
+    uart_puts(line); uart_puts("\n");
+    // Compare with supported commands and execute
+    if (!cmd_execute(line)) {
+        // Handle unrecognized command
+        uart_puts("Unrecognized command: \n");
+    }
+
+    //Return to command line
+    line_prompt();
 }
 
-// void SetPhyWHFrame(){
-//     unsigned int *physize = 0; // Pointer to response data
-//     mbox_buffer_setup(ADDR(mBuf), MBOX_TAG_SETPHYWH, &physize, 8, 8, 1024, 768);
-//     mbox_call(ADDR(mBuf), MBOX_CH_PROP);
-//     uart_puts("Got Actual Physical widthScreen: ");
-//     uart_dec(physize[0]); 
-//     uart_puts("\nGot Actual Physical heightScreen: ");
-//     uart_dec(physize[1]);
-//     uart_puts("\n");
-// }
+/**
+* Print board and firmware revision (cached) and the current ARM and
+* UART clocks (queried while the cached part is being printed)
+*/
+void getBoardInfo(){
+    const board_props *p = props_get();
+    mbox_req *req = mbox_req_alloc();
+    if (req == NULL) {
+        uart_puts("Unable to query!\n");
+        return;
+    }
+    volatile mbox_clock *arm = mbox_get_clock_rate(&req->msg, MBOX_CLK_ARM);
+    volatile mbox_clock *uart = mbox_get_clock_rate(&req->msg, MBOX_CLK_UART);
+    mbox_submit(req, NULL, NULL);
+
+    if (p->valid) {
+        uart_puts("Board revision: ");
+        uart_hex(p->revision);
+        uart_puts("\n\nFirmware revision: ");
+        uart_hex(p->firmware);
+        uart_puts("\n\n");
+    }
+    if (mbox_req_wait(req)) {
+        uart_puts("ARM clock rate = ");
+        uart_dec(arm->rate);
+        uart_puts("\n\nUART clock rate = ");
+        uart_dec(uart->rate);
+        uart_puts("\n");
+    } else {
+        uart_puts("Unable to query!\n");
+    }
+    mbox_req_free(req);
+}
+
+// Shell task: runs a command line whenever input is waiting (the game task reads it while playing)
+void cli_task(void *ctx) {
+    while (1) {
+        while (inGame || !uart_rx_ready())
+            task_sleep_ms(INPUT_POLL_MS);
+        cli();
+    }
+}
 
 void main(){
+    clock_init();
+
+    // exception vectors, mailbox completions by interrupt
+    irq_init();
+    mbox_irq_init();
+    timer_init();
+    sched_init();
+    irq_enable();
+
     // set up serial console
     framebf_init();
+    props_init();
+    perf_init();
     // drawRectARGB32(100,100,400,400,0x00AA0000,1); //RED
     // drawRectARGB32(150,150,400,400,0x0000BB00,1); //GREEN
     // drawRectARGB32(200,200,400,400,0x000000CC,1); //BLUE
@@ -735,25 +1059,25 @@ void main(){
     
 
 	uart_init();
-    uart_puts("\033[31m");
-	uart_puts("8888888888 8888888888 8888888888 88888888888  .d8888b.      d8888   .d8888b.   .d8888b.  \n");
-    uart_puts("888        888        888            888     d88P  Y88b    d8P888  d88P  Y88b d88P  Y88b \n");
-    uart_puts("888        888        888            888            888   d8P 888  888    888 888    888 \n");
-    uart_puts("8888888    8888888    8888888        888          .d88P  d8P  888  Y88b. d888 888    888 \n");
-    uart_puts("888        888        888            888      .od888P'  d88   888   'Y888P888 888    888 \n");
-    uart_puts("888        888        888            888     d88P'      8888888888        888 888    888\n");
-    uart_puts("888        888        888            888     888'             888  Y88b  d88P Y88b  d88P \n");
-    uart_puts("8888888888 8888888888 8888888888     888     888888888        888   'Y8888P'   'Y8888P'\n");
-    uart_puts("\n\n");
-    uart_puts("888888b.          d8888 8888888b.  8888888888      .d88888b.   .d8888b. \n");
-    uart_puts("888  '88b        d88888 888   Y88b 888            d88P' 'Y88b d88P  Y88b \n");
-    uart_puts("888  .88P       d88P888 888    888 888            888     888 Y88b.\n");
-    uart_puts("8888888K.      d88P 888 888   d88P 8888888        888     888  'Y888b.\n");
-    uart_puts("888  'Y88b    d88P  888 8888888P'  888            888     888     'Y88b.\n");
-    uart_puts("888    888   d88P   888 888 T88b   888            888     888       '888 \n");
-    uart_puts("888   d88P  d8888888888 888  T88b  888            Y88b. .d88P Y88b  d88P\n");
-    uart_puts("8888888P'  d88P     888 888   T88b 8888888888      'Y88888P'   'Y8888P'\n");
-    uart_puts("\n\n");
+    uart_dma_puts("\033[31m");
+	uart_dma_puts("8888888888 8888888888 8888888888 88888888888  .d8888b.      d8888   .d8888b.   .d8888b.  \n");
+    uart_dma_puts("888        888        888            888     d88P  Y88b    d8P888  d88P  Y88b d88P  Y88b \n");
+    uart_dma_puts("888        888        888            888            888   d8P 888  888    888 888    888 \n");
+    uart_dma_puts("8888888    8888888    8888888        888          .d88P  d8P  888  Y88b. d888 888    888 \n");
+    uart_dma_puts("888        888        888            888      .od888P'  d88   888   'Y888P888 888    888 \n");
+    uart_dma_puts("888        888        888            888     d88P'      8888888888        888 888    888\n");
+    uart_dma_puts("888        888        888            888     888'             888  Y88b  d88P Y88b  d88P \n");
+    uart_dma_puts("8888888888 8888888888 8888888888     888     888888888        888   'Y8888P'   'Y8888P'\n");
+    uart_dma_puts("\n\n");
+    uart_dma_puts("888888b.          d8888 8888888b.  8888888888      .d88888b.   .d8888b. \n");
+    uart_dma_puts("888  '88b        d88888 888   Y88b 888            d88P' 'Y88b d88P  Y88b \n");
+    uart_dma_puts("888  .88P       d88P888 888    888 888            888     888 Y88b.\n");
+    uart_dma_puts("8888888K.      d88P 888 888   d88P 8888888        888     888  'Y888b.\n");
+    uart_dma_puts("888  'Y88b    d88P  888 8888888P'  888            888     888     'Y88b.\n");
+    uart_dma_puts("888    888   d88P   888 888 T88b   888            888     888       '888 \n");
+    uart_dma_puts("888   d88P  d8888888888 888  T88b  888            Y88b. .d88P Y88b  d88P\n");
+    uart_dma_puts("8888888P'  d88P     888 888   T88b 8888888888      'Y88888P'   'Y8888P'\n");
+    uart_dma_puts("\n\n");
     uart_puts("Developed by Nguyen Giang Huy - s3836454\n");
     int num = 123;
     int nev_num = -123;
@@ -819,21 +1143,20 @@ void main(){
     printf("///////////////////////////////////////////////////////////////////////////////////////////\n");
     uart_puts("\033[37m");
     uart_puts("\n");
-    getBoardRevision();
-    uart_puts("\n");
-    getfirmwareRevision();
+    getBoardInfo();
     uart_puts("\n");
-    getARMclockrate();
-    uart_puts("\n");
-    getUARTclockrate();
-    uart_puts("\n");
-    // SetPhyWHFrame();
 
     uart_puts("\n"); 
-    uart_puts("MyBareMetalOS> ");              
-    
-    // run CLI
-    while(1) {
-    	cli();
-    }
-}
\ No newline at end of file
+
+    cmd_init(commands, sizeof(commands) / sizeof(commands[0]));
+    bench_register(game_benches, sizeof(game_benches) / sizeof(game_benches[0]));
+    line_init("MyBareMetalOS> ");
+#ifdef BOOT_SCRIPT
+    script_run_named(BOOT_SCRIPT);
+#endif
+    line_prompt();
+
+    // run CLI, video and game as tasks; main carries on as the idle task
+    task_create("shell", cli_task, NULL, SCHED_PRIO_HIGH);
+    sched_idle();
+}
\ No newline at end of file
@@ -3,6 +3,10 @@
 #include "gpio.h"
 #include "../uart/uart.h"
 #include "printf.h"
+#include "log.h"
+#include "irq.h"
+#include "clock.h"
+#include "stats.h"
 
 /* Mailbox Data Buffer (each element is 32-bit)*/
 /*
@@ -18,96 +22,434 @@
 * (last 4 bits is ZERO due to 16 byte alignment)
 *
 */
-volatile unsigned int __attribute__((aligned(16))) mBuf[36];
+volatile unsigned int __attribute__((aligned(16))) mBuf[MBOX_BUF_WORDS];
+
+/* Define MBOX_TRACE to LOG() every call and response */
+#ifdef MBOX_TRACE
+#define MBOX_LOG(...) LOG(__VA_ARGS__)
+#else
+#define MBOX_LOG(...) do { } while (0)
+#endif
+
+/* Requests waiting for a response (sync_req serves mbox_call) */
+static mbox_req mbox_pool[MBOX_POOL_SIZE];
+static volatile unsigned int __attribute__((aligned(16))) mbox_pool_buf[MBOX_POOL_SIZE][MBOX_POOL_WORDS];
+static mbox_req sync_req;
+
+/* Submitted requests that did not fit in the full MBOX1 FIFO, oldest first */
+static mbox_req *mbox_queue[MBOX_POOL_SIZE];
+static unsigned int mbox_queue_head = 0, mbox_queue_len = 0;
+
+static void (*mbox_channel_handlers[16])(unsigned int data);
+static int mbox_irq_on = 0;
+unsigned int mbox_unmatched = 0;
+mbox_counters mbox_stats;
+
+static mbox_req *mbox_find(unsigned int token)
+{
+    if (sync_req.state == MBOX_REQ_IN_FLIGHT && sync_req.token == token)
+        return &sync_req;
+    for (int i = 0; i < MBOX_POOL_SIZE; i++)
+        if (mbox_pool[i].state == MBOX_REQ_IN_FLIGHT && mbox_pool[i].token == token)
+            return &mbox_pool[i];
+    return NULL;
+}
+
+/* Move queued requests into MBOX1 while it has room (IRQs masked) */
+static void mbox_push_queued()
+{
+    while (mbox_queue_len > 0 && !(MBOX1_STATUS & MBOX_FULL)) {
+        mbox_req *req = mbox_queue[mbox_queue_head];
+        mbox_queue_head = (mbox_queue_head + 1) % MBOX_POOL_SIZE;
+        mbox_queue_len--;
+        req->state = MBOX_REQ_IN_FLIGHT;
+        MBOX1_WRITE = req->token;
+    }
+}
+
+/**
+* Complete the request a response belongs to (matched by buffer address and
+* channel). Responses nobody waits for go to the channel's handler.
+*/
+static void mbox_dispatch(unsigned int res)
+{
+    mbox_req *req = mbox_find(res);
+
+    if (req == NULL) {
+        if (mbox_channel_handlers[res & 0xF])
+            mbox_channel_handlers[res & 0xF](res & ~0xF);
+        else
+            mbox_unmatched++;
+        return;
+    }
+    /* is it a valid successful response (Response Code) ? */
+    req->ok = (req->msg.buf[1] == MBOX_RESPONSE);
+    req->state = MBOX_REQ_DONE;
+    if (req->done) {
+        req->done(req, req->ok, req->ctx);
+        mbox_req_free(req);
+    }
+    mbox_push_queued();
+}
+
+static void mbox_irq(void *ctx)
+{
+    while (!(MBOX0_STATUS & MBOX_EMPTY))
+        mbox_dispatch(MBOX0_READ);
+}
 
 /**
-* Read from the mailbox
+* Wait for a request: sleep in wfi until the mailbox IRQ completes it, or
+* poll the mailbox when interrupts are not available
 */
-uint32_t mailbox_read(unsigned char channel)
+static void mbox_wait(mbox_req *req)
 {
-    //Receiving message is buffer_addr & channel number
-    uint32_t res;
-    // Make sure that the message is from the right channel
-    do {
-        // Make sure there is mail to receive
-        do {
-            asm volatile("nop");
-        } while (MBOX0_STATUS & MBOX_EMPTY);
-        // Get the message
-        res = MBOX0_READ;
-    } while ( (res & 0xF) != channel);
+    unsigned long start = now_cycles();
 
-    return res;
+    while (req->state != MBOX_REQ_DONE) {
+        if (mbox_irq_on && irq_enabled()) {
+            unsigned long flags = irq_save();
+            if (req->state != MBOX_REQ_DONE)
+                asm volatile ("wfi"); // wakes up on the pending IRQ even while masked
+            irq_restore(flags);
+        } else if (!(MBOX0_STATUS & MBOX_EMPTY)) {
+            mbox_dispatch(MBOX0_READ);
+        }
+    }
+    unsigned long flags = irq_save();
+    STAT_ADD(mbox_stats.wait_cycles, now_cycles() - start);
+    irq_restore(flags);
 }
 
 /**
 * Write to the mailbox
 */
-void mailbox_send(uint32_t msg, unsigned char channel)
+static void mailbox_send(uint32_t msg)
 {
     //Sending message is buffer_addr & channel number
     // Make sure you can send mail
-    do {
+    while (MBOX1_STATUS & MBOX_FULL)
         asm volatile("nop");
-    } while (MBOX1_STATUS & MBOX_FULL);
     // send the message
     MBOX1_WRITE = msg;
 }
 
 /**
-* Make a mailbox call. Returns 0 on failure, non-zero on success
+* Make a mailbox call. Returns 0 on failure, non-zero on success.
+* Not to be used from IRQ context (completion callbacks).
 */
 int mbox_call(unsigned int buffer_addr, unsigned char channel)
 {
+    PROF_SCOPE("mbox_call");
+
     //Check Buffer Address
-    uart_puts("Buffer Address: ");
-    uart_hex(buffer_addr);
-    uart_sendc('\n');
+    MBOX_LOG("mbox_call: buffer address %x, channel %d", buffer_addr, channel);
 
     //Prepare Data (address of Message Buffer)
-    unsigned int msg = (buffer_addr & ~0xF) | (channel & 0xF);
-    mailbox_send(msg, channel);
+    unsigned long flags = irq_save();
+    sync_req.msg.buf = (volatile unsigned int *)((unsigned long)buffer_addr);
+    sync_req.token = (buffer_addr & ~0xF) | (channel & 0xF);
+    sync_req.done = NULL;
+    sync_req.state = MBOX_REQ_IN_FLIGHT;
+    mailbox_send(sync_req.token);
+    STAT_INC(mbox_stats.calls);
+    irq_restore(flags);
 
-    /* now wait for the response */
-    /* is it a response to our message (same address)? */
-    if (msg == mailbox_read(channel)) {
-        /* is it a valid successful response (Response Code) ? */
-        if (mBuf[1] == MBOX_RESPONSE)
-            uart_puts("Got successful response \n");
+    /* now wait for the response to our message (same address) */
+    mbox_wait(&sync_req);
+    sync_req.state = MBOX_REQ_FREE;
+    if (sync_req.ok)
+        MBOX_LOG("mbox_call: got successful response");
 
-        return (mBuf[1] == MBOX_RESPONSE);
-    }
+    return sync_req.ok;
+}
+
+/* Value buffer handed out once a message is full (3 words tag header first) */
+static volatile unsigned int mbox_overflow_tag[3 + 8];
 
-    return 0;
+/**
+* Start an empty property message in buf (16-byte aligned, words long)
+*/
+void mbox_msg_init(mbox_msg *m, volatile unsigned int *buf, unsigned int words)
+{
+    m->buf = buf;
+    m->size = words;
+    m->len = 2; // size and request code
+    m->overflow = 0;
 }
 
-void mbox_buffer_setup(unsigned int buffer_addr, unsigned int tag_identifier,
-                       unsigned int **res_data, unsigned int res_length,
-                       unsigned int req_length, ...) {
-    va_list args;
-    va_start(args, req_length);
-    unsigned int *mbox= (unsigned int *) ((unsigned long) buffer_addr);
+/**
+* Append a tag with a value buffer of value_words (cleared) words.
+* Returns the value buffer, to fill in the request values.
+*/
+volatile unsigned int *mbox_msg_tag(mbox_msg *m, unsigned int tag, unsigned int value_words)
+{
+    volatile unsigned int *p;
 
-    int index = 0;
-    mbox[1] = MBOX_REQUEST; // Message Request Code (this is a request message)
+    // tag header + value, keeping one word for the end tag
+    if (m->len + 3 + value_words + 1 > m->size || value_words > 8) {
+        m->overflow = 1;
+        p = mbox_overflow_tag;
+    } else {
+        p = m->buf + m->len;
+        m->len += 3 + value_words;
+    }
+    p[0] = tag; // TAG Identifier
+    p[1] = value_words * 4; // Value buffer size in bytes
+    p[2] = 0; // REQUEST CODE = 0
+    for (unsigned int i = 0; i < value_words; i++)
+        p[3 + i] = 0;
+    return p + 3;
+}
 
-    mbox[2] = tag_identifier; // TAG Identifier
-    mbox[3] = res_length > req_length ? res_length: req_length; // Value buffer size in bytes (max of request and response lengths)
-    mbox[4] = 0; // REQUEST CODE = 0
+/* Fill in size, request code and end tag */
+static void mbox_msg_finish(mbox_msg *m)
+{
+    m->buf[0] = (m->len + 1) * 4; // Message Buffer Size in bytes
+    m->buf[1] = MBOX_REQUEST;
+    m->buf[m->len] = MBOX_TAG_LAST;
+}
 
-    for (unsigned int i = 0; i < req_length/4; i++) {
-        mbox[5 + i] = va_arg(args, unsigned int);
-        res_data[i] = (unsigned int *)&mbox[5 + index];
-        index ++;
+/**
+* Submit the message in one round trip. Returns 0 on failure, non-zero on success
+*/
+int mbox_msg_send(mbox_msg *m)
+{
+    if (m->overflow)
+        return 0;
+    mbox_msg_finish(m);
+    return mbox_call(ADDR(m->buf), MBOX_CH_PROP);
+}
+
+/**
+* Take a request buffer from the pool (NULL when all are in use) and start
+* an empty property message in it: add tags with the builders on &req->msg
+*/
+mbox_req *mbox_req_alloc()
+{
+    unsigned long flags = irq_save();
+    for (int i = 0; i < MBOX_POOL_SIZE; i++) {
+        mbox_req *req = &mbox_pool[i];
+        if (req->state == MBOX_REQ_FREE) {
+            req->state = MBOX_REQ_BUILDING;
+            irq_restore(flags);
+            mbox_msg_init(&req->msg, mbox_pool_buf[i], MBOX_POOL_WORDS);
+            req->done = NULL;
+            req->ok = 0;
+            return req;
+        }
     }
+    irq_restore(flags);
+    return NULL;
+}
 
-    if (va_arg(args, unsigned int) == 0){
-        *res_data = (unsigned int *)&mbox[5];
+/**
+* Return a request to the pool
+*/
+void mbox_req_free(mbox_req *req)
+{
+    req->state = MBOX_REQ_FREE;
+}
+
+/**
+* Send a request without waiting for the response. With a callback, done
+* is called from the mailbox IRQ once the response arrived (read the views
+* there) and the request is freed afterwards; without one, poll
+* mbox_req_done() or call mbox_req_wait(), then mbox_req_free().
+* Returns 0 when the message overflowed its buffer (nothing sent).
+*/
+int mbox_submit(mbox_req *req, mbox_done done, void *ctx)
+{
+    if (req->msg.overflow)
+        return 0;
+    mbox_msg_finish(&req->msg);
+    req->done = done;
+    req->ctx = ctx;
+    req->token = (ADDR(req->msg.buf) & ~0xF) | MBOX_CH_PROP;
+
+    unsigned long flags = irq_save();
+    if (mbox_queue_len > 0 || (MBOX1_STATUS & MBOX_FULL)) {
+        req->state = MBOX_REQ_QUEUED;
+        mbox_queue[(mbox_queue_head + mbox_queue_len) % MBOX_POOL_SIZE] = req;
+        mbox_queue_len++;
+    } else {
+        req->state = MBOX_REQ_IN_FLIGHT;
+        MBOX1_WRITE = req->token;
     }
+    STAT_INC(mbox_stats.calls); // also counted from IRQ context (perf)
+    irq_restore(flags);
+
+    // Without the mailbox IRQ, complete it right away
+    if (!mbox_irq_on && done)
+        mbox_wait(req);
+    return 1;
+}
+
+int mbox_req_done(mbox_req *req)
+{
+    return req->state == MBOX_REQ_DONE;
+}
+
+/**
+* Wait for a request submitted without callback. Returns 0 on failure,
+* non-zero on success
+*/
+int mbox_req_wait(mbox_req *req)
+{
+    mbox_wait(req);
+    return req->ok;
+}
+
+/**
+* Receive mailbox messages on channel that are not responses to our
+* requests (data is the message without the channel bits)
+*/
+void mbox_set_channel_handler(unsigned char channel, void (*handler)(unsigned int data))
+{
+    mbox_channel_handlers[channel & 0xF] = handler;
+}
+
+/**
+* Complete requests from the mailbox IRQ from now on (call after irq_init)
+*/
+void mbox_irq_init()
+{
+    irq_register(IRQ_MAILBOX, mbox_irq, NULL);
+    MBOX0_CONFIG = 1; // IRQ when mailbox 0 has data
+    irq_unmask(IRQ_MAILBOX);
+    mbox_irq_on = 1;
+}
+
+/**
+* Was the tag behind a view processed by the VideoCore?
+*/
+int mbox_tag_ok(volatile void *view)
+{
+    return (((volatile unsigned int *)view)[-1] & MBOX_TAG_RESPONSE) != 0;
+}
+
+volatile mbox_value *mbox_get_firmware(mbox_msg *m)
+{
+    return (volatile mbox_value *)mbox_msg_tag(m, MBOX_TAG_GETFIRMWARE, 1);
+}
+
+volatile mbox_value *mbox_get_board_revision(mbox_msg *m)
+{
+    return (volatile mbox_value *)mbox_msg_tag(m, MBOX_TAG_GETBOARDREV, 1);
+}
+
+volatile mbox_mac *mbox_get_mac(mbox_msg *m)
+{
+    return (volatile mbox_mac *)mbox_msg_tag(m, MBOX_TAG_GETMAC, 2);
+}
 
-    mbox[0] = (6 + index) *4; // Message Buffer Size in bytes
+volatile mbox_serial *mbox_get_serial(mbox_msg *m)
+{
+    return (volatile mbox_serial *)mbox_msg_tag(m, MBOX_TAG_GETSERIAL, 2);
+}
+
+volatile mbox_mem *mbox_get_arm_memory(mbox_msg *m)
+{
+    return (volatile mbox_mem *)mbox_msg_tag(m, MBOX_TAG_GETARMMEM, 2);
+}
+
+volatile mbox_mem *mbox_get_vc_memory(mbox_msg *m)
+{
+    return (volatile mbox_mem *)mbox_msg_tag(m, MBOX_TAG_GETVCMEM, 2);
+}
+
+static volatile mbox_clock *mbox_clock_tag(mbox_msg *m, unsigned int tag, unsigned int clock_id)
+{
+    volatile unsigned int *v = mbox_msg_tag(m, tag, 2);
+    v[0] = clock_id;
+    return (volatile mbox_clock *)v;
+}
 
-    mbox[5+ index + 1] = MBOX_TAG_LAST;
+volatile mbox_clock *mbox_get_clock_rate(mbox_msg *m, unsigned int clock_id)
+{
+    return mbox_clock_tag(m, MBOX_TAG_GETCLKRATE, clock_id);
+}
 
-    va_end(args);
-}
\ No newline at end of file
+volatile mbox_clock *mbox_get_min_clock_rate(mbox_msg *m, unsigned int clock_id)
+{
+    return mbox_clock_tag(m, MBOX_TAG_GETMINCLKRATE, clock_id);
+}
+
+volatile mbox_clock *mbox_get_max_clock_rate(mbox_msg *m, unsigned int clock_id)
+{
+    return mbox_clock_tag(m, MBOX_TAG_GETMAXCLKRATE, clock_id);
+}
+
+/**
+* Set a clock rate. Unless skip_turbo is set, the firmware also applies its
+* turbo settings (voltages, and on the Pi 3 the core clock) when the ARM
+* clock goes above its minimum
+*/
+volatile mbox_clock *mbox_set_clock_rate(mbox_msg *m, unsigned int clock_id, unsigned int rate,
+                                         unsigned int skip_turbo)
+{
+    volatile unsigned int *v = mbox_msg_tag(m, MBOX_TAG_SETCLKRATE, 3);
+    v[0] = clock_id;
+    v[1] = rate;
+    v[2] = skip_turbo;
+    return (volatile mbox_clock *)v;
+}
+
+volatile mbox_sensor *mbox_get_temperature(mbox_msg *m)
+{
+    return (volatile mbox_sensor *)mbox_msg_tag(m, MBOX_TAG_GETTEMP, 2); // id 0: SoC
+}
+
+volatile mbox_sensor *mbox_get_max_temperature(mbox_msg *m)
+{
+    return (volatile mbox_sensor *)mbox_msg_tag(m, MBOX_TAG_GETMAXTEMP, 2);
+}
+
+static volatile mbox_size *mbox_size_tag(mbox_msg *m, unsigned int tag, unsigned int a, unsigned int b)
+{
+    volatile unsigned int *v = mbox_msg_tag(m, tag, 2);
+    v[0] = a;
+    v[1] = b;
+    return (volatile mbox_size *)v;
+}
+
+volatile mbox_size *mbox_set_physical_size(mbox_msg *m, unsigned int width, unsigned int height)
+{
+    return mbox_size_tag(m, MBOX_TAG_SETPHYWH, width, height);
+}
+
+volatile mbox_size *mbox_set_virtual_size(mbox_msg *m, unsigned int width, unsigned int height)
+{
+    return mbox_size_tag(m, MBOX_TAG_SETVIRTWH, width, height);
+}
+
+volatile mbox_size *mbox_set_virtual_offset(mbox_msg *m, unsigned int x, unsigned int y)
+{
+    return mbox_size_tag(m, MBOX_TAG_SETVIRTOFF, x, y);
+}
+
+volatile mbox_value *mbox_set_depth(mbox_msg *m, unsigned int bits_per_pixel)
+{
+    volatile unsigned int *v = mbox_msg_tag(m, MBOX_TAG_SETDEPTH, 1);
+    v[0] = bits_per_pixel;
+    return (volatile mbox_value *)v;
+}
+
+volatile mbox_value *mbox_set_pixel_order(mbox_msg *m, unsigned int order)
+{
+    volatile unsigned int *v = mbox_msg_tag(m, MBOX_TAG_SETPXLORDR, 1);
+    v[0] = order;
+    return (volatile mbox_value *)v;
+}
+
+volatile mbox_fb *mbox_alloc_fb(mbox_msg *m, unsigned int alignment)
+{
+    volatile unsigned int *v = mbox_msg_tag(m, MBOX_TAG_GETFB, 2);
+    v[0] = alignment;
+    return (volatile mbox_fb *)v;
+}
+
+volatile mbox_value *mbox_get_pitch(mbox_msg *m)
+{
+    return (volatile mbox_value *)mbox_msg_tag(m, MBOX_TAG_GETPITCH, 1);
+}
@@ -1,6 +1,10 @@
+#ifndef MBOX_H
+#define MBOX_H
+
 #include "gpio.h"
 /* a properly aligned buffer */
-extern volatile unsigned int mBuf[36];
+#define MBOX_BUF_WORDS 36
+extern volatile unsigned int mBuf[MBOX_BUF_WORDS];
 #define ADDR(X) (unsigned int)((unsigned long) X)
 
 /* Registers */
@@ -35,8 +39,18 @@ extern volatile unsigned int mBuf[36];
 #define MBOX_CH_PROP 8 //Property tags (ARM -> VC)
 
 /* tags */
+#define MBOX_TAG_GETFIRMWARE 0x00000001 //Get firmware revision
 #define MBOX_TAG_GETSERIAL 0x00010004 //Get board serial
 #define MBOX_TAG_GETMODEL 0x00010001 //Get board model
+#define MBOX_TAG_GETBOARDREV 0x00010002 //Get board revision
+#define MBOX_TAG_GETMAC 0x00010003 //Get board MAC address
+#define MBOX_TAG_GETARMMEM 0x00010005 //Get ARM memory split
+#define MBOX_TAG_GETVCMEM 0x00010006 //Get VideoCore memory split
+#define MBOX_TAG_GETCLKRATE 0x00030002
+#define MBOX_TAG_GETMAXCLKRATE 0x00030004
+#define MBOX_TAG_GETMINCLKRATE 0x00030007
+#define MBOX_TAG_GETTEMP 0x00030006 //Get SoC temperature (thousandths of a degree C)
+#define MBOX_TAG_GETMAXTEMP 0x0003000A //Get temperature where the firmware throttles
 #define MBOX_TAG_SETCLKRATE 0x00038002
 #define MBOX_TAG_LAST 0
 
@@ -49,5 +63,107 @@ extern volatile unsigned int mBuf[36];
 #define MBOX_TAG_GETFB 0x40001
 #define MBOX_TAG_GETPITCH 0x40008
 
+/* clock ids */
+#define MBOX_CLK_EMMC 1
+#define MBOX_CLK_UART 2
+#define MBOX_CLK_ARM 3
+#define MBOX_CLK_CORE 4
+
+//Tag response code bit (set by the VideoCore in each processed tag)
+#define MBOX_TAG_RESPONSE 0x80000000
+
+/*
+* Property message builder: any number of tags are packed into one aligned
+* buffer and submitted in a single round trip. Each tag builder returns a
+* typed view of its value buffer, which holds the response after
+* mbox_msg_send(). When the buffer is full, builders return a dummy view
+* and mbox_msg_send() fails, so views can always be dereferenced.
+*
+*   mbox_msg m;
+*   mbox_msg_init(&m, mBuf, MBOX_BUF_WORDS);
+*   volatile mbox_value *rev = mbox_get_board_revision(&m);
+*   volatile mbox_clock *arm = mbox_get_clock_rate(&m, MBOX_CLK_ARM);
+*   if (mbox_msg_send(&m)) ... rev->value, arm->rate ...
+*/
+typedef struct {
+    volatile unsigned int *buf; // 16-byte aligned message buffer
+    unsigned int size;          // capacity in words
+    unsigned int len;           // words used (header and tags)
+    int overflow;               // a tag did not fit
+} mbox_msg;
+
+/* Typed response views */
+typedef struct { unsigned int value; } mbox_value;
+typedef struct { unsigned int id, rate; } mbox_clock;
+typedef struct { unsigned int width, height; } mbox_size;
+typedef struct { unsigned int base, size; } mbox_fb;
+typedef struct { unsigned int base, size; } mbox_mem;
+typedef struct { unsigned int low, high; } mbox_serial;
+typedef struct { unsigned int id, value; } mbox_sensor;
+typedef struct { unsigned char addr[6]; } mbox_mac;
+
+/*
+* Asynchronous requests: messages built in a pool of aligned buffers,
+* several in flight at once, matched to their responses by buffer address
+* and completed from the mailbox IRQ (see mbox_submit)
+*/
+#define MBOX_POOL_SIZE 4
+#define MBOX_POOL_WORDS 64
+
+#define MBOX_REQ_FREE 0
+#define MBOX_REQ_BUILDING 1
+#define MBOX_REQ_QUEUED 2 //waiting for room in MBOX1
+#define MBOX_REQ_IN_FLIGHT 3
+#define MBOX_REQ_DONE 4
+
+typedef struct mbox_req mbox_req;
+typedef void (*mbox_done)(mbox_req *req, int ok, void *ctx);
+
+struct mbox_req {
+    mbox_msg msg;           // add tags with the builders on &req->msg
+    mbox_done done;         // completion callback (IRQ context) or NULL
+    void *ctx;
+    unsigned int token;     // buffer address | channel, as sent
+    volatile int state;     // MBOX_REQ_*
+    volatile int ok;        // the response code was MBOX_RESPONSE
+};
+
+extern unsigned int mbox_unmatched; // responses nobody waited for
+
 /* Function Prototypes */
-int mbox_call(unsigned int buffer_addr, unsigned char channel);
\ No newline at end of file
+int mbox_call(unsigned int buffer_addr, unsigned char channel);
+void mbox_msg_init(mbox_msg *m, volatile unsigned int *buf, unsigned int words);
+volatile unsigned int *mbox_msg_tag(mbox_msg *m, unsigned int tag, unsigned int value_words);
+int mbox_msg_send(mbox_msg *m);
+int mbox_tag_ok(volatile void *view);
+mbox_req *mbox_req_alloc();
+void mbox_req_free(mbox_req *req);
+int mbox_submit(mbox_req *req, mbox_done done, void *ctx);
+int mbox_req_done(mbox_req *req);
+int mbox_req_wait(mbox_req *req);
+void mbox_set_channel_handler(unsigned char channel, void (*handler)(unsigned int data));
+void mbox_irq_init();
+
+/* Tag builders */
+volatile mbox_value *mbox_get_firmware(mbox_msg *m);
+volatile mbox_value *mbox_get_board_revision(mbox_msg *m);
+volatile mbox_mac *mbox_get_mac(mbox_msg *m);
+volatile mbox_serial *mbox_get_serial(mbox_msg *m);
+volatile mbox_mem *mbox_get_arm_memory(mbox_msg *m);
+volatile mbox_mem *mbox_get_vc_memory(mbox_msg *m);
+volatile mbox_clock *mbox_get_clock_rate(mbox_msg *m, unsigned int clock_id);
+volatile mbox_clock *mbox_get_min_clock_rate(mbox_msg *m, unsigned int clock_id);
+volatile mbox_clock *mbox_get_max_clock_rate(mbox_msg *m, unsigned int clock_id);
+volatile mbox_clock *mbox_set_clock_rate(mbox_msg *m, unsigned int clock_id, unsigned int rate,
+                                         unsigned int skip_turbo);
+volatile mbox_sensor *mbox_get_temperature(mbox_msg *m);
+volatile mbox_sensor *mbox_get_max_temperature(mbox_msg *m);
+volatile mbox_size *mbox_set_physical_size(mbox_msg *m, unsigned int width, unsigned int height);
+volatile mbox_size *mbox_set_virtual_size(mbox_msg *m, unsigned int width, unsigned int height);
+volatile mbox_size *mbox_set_virtual_offset(mbox_msg *m, unsigned int x, unsigned int y);
+volatile mbox_value *mbox_set_depth(mbox_msg *m, unsigned int bits_per_pixel);
+volatile mbox_value *mbox_set_pixel_order(mbox_msg *m, unsigned int order);
+volatile mbox_fb *mbox_alloc_fb(mbox_msg *m, unsigned int alignment);
+volatile mbox_value *mbox_get_pitch(mbox_msg *m);
+
+#endif
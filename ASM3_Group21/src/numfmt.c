@@ -0,0 +1,261 @@
+// -----------------------------------numfmt.c -------------------------------------
+#include "numfmt.h"
+
+/* "00" "01" ... "99": two decimal digits per lookup */
+static const char dec_pairs[200] = {
+    '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+    '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+    '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+    '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+    '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+    '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+    '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+    '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+    '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+    '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9'
+};
+
+static const char hex_lower[16] = "0123456789abcdef";
+static const char hex_upper[16] = "0123456789ABCDEF";
+
+/* v / 100 for any 64-bit v: multiply by the reciprocal 2^68/100 (rounded up)
+   after pre-shifting by 2, keeping the high half (a single umulh) */
+static inline unsigned long div100_u64(unsigned long v)
+{
+    return (unsigned long)(((unsigned __int128)(v >> 2) * 0x28F5C28F5C28F5C3UL) >> 64) >> 2;
+}
+
+/* v / 100 for v < 2^32: 32x32->64 multiply by 2^37/100 */
+static inline unsigned int div100_u32(unsigned int v)
+{
+    return (unsigned int)(((unsigned long)v * 0x51EB851FUL) >> 37);
+}
+
+/**
+* Unsigned decimal conversion, two digits per step
+*/
+char *fmt_u64_dec(char *end, unsigned long v)
+{
+    char *p = end;
+
+    // full 64-bit steps until the value fits in 32 bits
+    while (v >= 0x100000000UL) {
+        unsigned long q = div100_u64(v);
+        const char *d = &dec_pairs[(v - q * 100) * 2];
+        *--p = d[1];
+        *--p = d[0];
+        v = q;
+    }
+
+    unsigned int w = (unsigned int)v;
+    while (w >= 100) {
+        unsigned int q = div100_u32(w);
+        const char *d = &dec_pairs[(w - q * 100) * 2];
+        *--p = d[1];
+        *--p = d[0];
+        w = q;
+    }
+    if (w >= 10) {
+        *--p = dec_pairs[w * 2 + 1];
+        *--p = dec_pairs[w * 2];
+    } else {
+        *--p = '0' + w;
+    }
+    return p;
+}
+
+/**
+* Signed decimal conversion (handles the most negative value)
+*/
+char *fmt_i64_dec(char *end, long v)
+{
+    if (v >= 0)
+        return fmt_u64_dec(end, (unsigned long)v);
+
+    char *p = fmt_u64_dec(end, -(unsigned long)v);
+    *--p = '-';
+    return p;
+}
+
+/**
+* Hexadecimal conversion without leading zeros (at least min_digits digits).
+* The digit count comes from the leading zero count, so the loop has no
+* data dependent exit and each nibble is a table lookup.
+*/
+char *fmt_u64_hex(char *end, unsigned long v, int upper, int min_digits)
+{
+    const char *digits = upper ? hex_upper : hex_lower;
+    int n = (64 - __builtin_clzl(v | 1) + 3) >> 2;
+    if (n < min_digits)
+        n = min_digits > 16 ? 16 : min_digits;
+
+    char *p = end - n;
+    for (int i = n - 1; i >= 0; i--) {
+        p[i] = digits[v & 0xF];
+        v >>= 4;
+    }
+    return p;
+}
+
+/* --------------------------- floating point --------------------------- */
+
+/* 2^1024 needs 32 limbs of 32 bits, the 1074-bit fraction of the smallest
+   subnormal 34 */
+#define FLOAT_LIMBS 36
+#define GROUP 1000000000U    /* 9 decimal digits per bignum pass */
+
+/* Write the 9 digits of a group (leading zeros kept) */
+static void put_group(char *p, unsigned int g)
+{
+    for (int i = 8; i >= 0; i--) {
+        p[i] = '0' + g % 10;
+        g /= 10;
+    }
+}
+
+/* Integer part m * 2^e (e >= 0) in decimal; returns the number of digits */
+static int big_int_digits(char *buf, unsigned long m, int e)
+{
+    unsigned int limbs[FLOAT_LIMBS];
+    unsigned int groups[FLOAT_LIMBS + 2];
+    int n = 0, ng = 0;
+
+    // m << e as little endian 32-bit limbs
+    int word = e >> 5, bit = e & 31;
+    for (int i = 0; i < word; i++)
+        limbs[i] = 0;
+    unsigned __int128 t = (unsigned __int128)m << bit;
+    for (n = word; t != 0; n++) {
+        limbs[n] = (unsigned int)t;
+        t >>= 32;
+    }
+
+    // repeated division by 10^9 from the top limb down
+    while (n > 0) {
+        unsigned long rem = 0;
+        for (int i = n - 1; i >= 0; i--) {
+            unsigned long cur = (rem << 32) | limbs[i];
+            limbs[i] = (unsigned int)(cur / GROUP);
+            rem = cur % GROUP;
+        }
+        groups[ng++] = (unsigned int)rem;
+        while (n > 0 && limbs[n - 1] == 0)
+            n--;
+    }
+
+    // most significant group without leading zeros, the rest 9 digits each
+    char first[NUMFMT_MAX_CHARS];
+    char *p = fmt_u64_dec(first + sizeof(first), groups[ng - 1]);
+    int len = first + sizeof(first) - p;
+    for (int i = 0; i < len; i++)
+        buf[i] = p[i];
+    for (int g = ng - 2; g >= 0; g--, len += 9)
+        put_group(buf + len, groups[g]);
+    return len;
+}
+
+/**
+* Fixed notation conversion, see numfmt.h
+*/
+int fmt_double_fixed(char *buf, double v, int precision, int *negative)
+{
+    union { double d; unsigned long u; } bits = { .d = v };
+    unsigned long frac = bits.u & ((1UL << 52) - 1);
+    int exp = (int)((bits.u >> 52) & 0x7FF);
+    int len;
+
+    *negative = (int)(bits.u >> 63);
+    if (exp == 0x7FF) {
+        const char *s = frac ? "nan" : "inf";
+        buf[0] = s[0]; buf[1] = s[1]; buf[2] = s[2];
+        return 3;
+    }
+    if (precision < 0)
+        precision = 6;
+    if (precision > NUMFMT_DOUBLE_MAX_PRECISION)
+        precision = NUMFMT_DOUBLE_MAX_PRECISION;
+
+    // v = m * 2^e exactly
+    unsigned long m = exp ? (frac | (1UL << 52)) : frac;
+    int e = exp ? exp - 1075 : -1074;
+
+    if (e >= 0) {
+        // no fractional bits: integer digits, then zeros
+        len = big_int_digits(buf, m, e);
+        if (precision > 0)
+            buf[len++] = '.';
+        for (int i = 0; i < precision; i++)
+            buf[len++] = '0';
+        return len;
+    }
+
+    int k = -e; // number of fractional bits
+    char *p = fmt_u64_dec(buf + NUMFMT_MAX_CHARS, k < 64 ? m >> k : 0);
+    len = buf + NUMFMT_MAX_CHARS - p;
+    for (int i = 0; i < len; i++)
+        buf[i] = p[i];
+    int int_len = len;
+
+    // fraction r / 2^k, left aligned into L limbs: value = limbs / 2^(32L)
+    unsigned long r = k < 64 ? m & ((1UL << k) - 1) : m;
+    unsigned int limbs[FLOAT_LIMBS];
+    int L = (k + 31) >> 5;
+    int shift = 32 * L - k;
+    int lo = 0;
+    for (int i = 0; i < L; i++)
+        limbs[i] = 0;
+    // r < 2^53 and shift < 32: r << shift fits in the 3 lowest limbs
+    unsigned __int128 t = (unsigned __int128)r << shift;
+    for (int i = 0; i < L && t != 0; i++) {
+        limbs[i] = (unsigned int)t;
+        t >>= 32;
+    }
+    while (lo < L && limbs[lo] == 0)
+        lo++;
+
+    // produce precision + 1 digits (one more to round on), 9 per pass
+    char digits[NUMFMT_DOUBLE_MAX_PRECISION + 9 + 1];
+    int nd = 0;
+    while (nd < precision + 1) {
+        unsigned long carry = 0;
+        for (int i = lo; i < L; i++) {
+            unsigned long cur = (unsigned long)limbs[i] * GROUP + carry;
+            limbs[i] = (unsigned int)cur;
+            carry = cur >> 32;
+        }
+        put_group(digits + nd, (unsigned int)carry);
+        nd += 9;
+        while (lo < L && limbs[lo] == 0)
+            lo++;
+    }
+
+    if (precision > 0)
+        buf[len++] = '.';
+    for (int i = 0; i < precision; i++)
+        buf[len++] = digits[i];
+
+    // round half to even on the exact remainder
+    int next = digits[precision] - '0';
+    int rest = lo < L;
+    for (int i = precision + 1; i < nd && !rest; i++)
+        rest = digits[i] != '0';
+    int last = (precision > 0 ? digits[precision - 1] : buf[int_len - 1]) - '0';
+    if (next > 5 || (next == 5 && (rest || (last & 1)))) {
+        int i = len - 1;
+        while (i >= 0 && (buf[i] == '9' || buf[i] == '.')) {
+            if (buf[i] == '9')
+                buf[i] = '0';
+            i--;
+        }
+        if (i >= 0) {
+            buf[i]++;
+        } else {
+            // carried out of the top digit: 9.99 -> 10.00
+            for (int j = len; j > 0; j--)
+                buf[j] = buf[j - 1];
+            buf[0] = '1';
+            len++;
+        }
+    }
+    return len;
+}
@@ -0,0 +1,29 @@
+// -----------------------------------numfmt.h -------------------------------------
+#ifndef NUMFMT_H
+#define NUMFMT_H
+
+/*
+* Integer to text conversion shared by uart_dec/uart_hex and printf.
+* Digits are written backwards ending just before `end` (no terminator);
+* the return value points at the first character.
+* A buffer of NUMFMT_MAX_CHARS bytes holds any 64-bit value.
+*/
+#define NUMFMT_MAX_CHARS 21
+
+char *fmt_u64_dec(char *end, unsigned long v);
+char *fmt_i64_dec(char *end, long v);
+char *fmt_u64_hex(char *end, unsigned long v, int upper, int min_digits);
+
+/*
+* Fixed notation for doubles ("%.<precision>f" without the sign), exact
+* for the whole double range and rounded half to even like glibc. Uses
+* integer arithmetic only. Writes into buf, which must hold
+* NUMFMT_DOUBLE_CHARS bytes, and returns the length (no terminator).
+* *negative is set from the sign bit; inf and nan give "inf"/"nan".
+*/
+#define NUMFMT_DOUBLE_MAX_PRECISION 64
+#define NUMFMT_DOUBLE_CHARS (310 + 1 + NUMFMT_DOUBLE_MAX_PRECISION)
+
+int fmt_double_fixed(char *buf, double v, int precision, int *negative);
+
+#endif
@@ -0,0 +1,479 @@
+// -----------------------------------path.c -------------------------------------
+#include "path.h"
+#include "clock.h"
+#ifdef __ARM_NEON
+#include "../gcclib/arm_neon.h"
+#endif
+
+/* Node pool: entries are only valid for squares marked in seen */
+static unsigned int g[PATH_MAX_SQUARES];        // steps from the start
+static unsigned int parent[PATH_MAX_SQUARES];   // previous node on the best path
+static unsigned int heap_pos[PATH_MAX_SQUARES]; // index in heap while open
+static unsigned long heap[PATH_MAX_SQUARES];    // open nodes, see HEAP_KEY
+static unsigned long seen[PATH_MAX_SQUARES / 64];
+static unsigned long closed[PATH_MAX_SQUARES / 64];
+static int heap_n;
+
+/* The search in progress */
+static const maze_map *map;
+static int goal_x, goal_y;
+
+#define BIT_TEST(set, i) ((set)[(i) >> 6] & (1UL << ((i) & 63)))
+#define BIT_SET(set, i) ((set)[(i) >> 6] |= 1UL << ((i) & 63))
+
+/*
+* A heap entry packs f = g + h, h and the square in one word, so that a
+* single compare orders the heap: lowest f first and, on a tie, the node
+* nearer the goal. f < 2^22 and h, square < 2^21 for PATH_MAX_SQUARES.
+*/
+#define HEAP_KEY(f, h, sq) ((unsigned long)(f) << 42 | (unsigned long)(h) << 21 | (sq))
+#define HEAP_SQUARE(e) ((unsigned int)((e) & ((1UL << 21) - 1)))
+
+static inline int distance(int a, int b)
+{
+    int dx = a % map->width - b % map->width, dy = a / map->width - b / map->width;
+    return (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+}
+
+static inline void heap_place(unsigned int i, unsigned long e)
+{
+    heap[i] = e;
+    heap_pos[HEAP_SQUARE(e)] = i;
+}
+
+static void sift_up(unsigned int i)
+{
+    unsigned long e = heap[i];
+    while (i > 0 && e < heap[(i - 1) / 2]) {
+        heap_place(i, heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    heap_place(i, e);
+}
+
+static unsigned int heap_pop()
+{
+    unsigned int top = HEAP_SQUARE(heap[0]);
+    unsigned long e = heap[--heap_n];
+    unsigned int i = 0;
+
+    while (2 * i + 1 < heap_n) {
+        unsigned int c = 2 * i + 1;
+        if (c + 1 < heap_n && heap[c + 1] < heap[c])
+            c++;
+        if (heap[c] >= e)
+            break;
+        heap_place(i, heap[c]);
+        i = c;
+    }
+    if (heap_n > 0)
+        heap_place(i, e);
+    return top;
+}
+
+/* Reach sq from node from with g = cost: open it, or lower its g if that is better */
+static void relax(unsigned int sq, unsigned int from, unsigned int cost)
+{
+    unsigned int i;
+
+    if (!BIT_TEST(seen, sq)) {
+        BIT_SET(seen, sq);
+        i = heap_n++;
+    } else if (cost < g[sq] && !BIT_TEST(closed, sq)) {
+        i = heap_pos[sq];
+    } else {
+        return;
+    }
+    unsigned int h = distance(sq, goal_y * map->width + goal_x);
+    g[sq] = cost;
+    parent[sq] = from;
+    heap[i] = HEAP_KEY(cost + h, h, sq);
+    sift_up(i);
+}
+
+/* Steps of the four directions: north, east, south, west */
+static const int dir_x[4] = { 0, 1, 0, -1 };
+static const int dir_y[4] = { -1, 0, 1, 0 };
+
+/* Direction of the last move into sq, -1 for the start */
+static int arrived(unsigned int sq)
+{
+    unsigned int p = parent[sq];
+    if (p == sq)
+        return -1;
+    if (p / map->width == sq / map->width)
+        return p < sq ? 1 : 3;
+    return p < sq ? 2 : 0;
+}
+
+/* Open squares of word i of row y that have an open square above or below: where a run across must stop */
+static inline uint64_t side_openings(int y, int i)
+{
+    uint64_t side = 0;
+    if (y > 0)
+        side |= maze_open_word(map, y - 1, i);
+    if (y + 1 < map->height)
+        side |= maze_open_word(map, y + 1, i);
+    if (y == goal_y && goal_x >> 6 == i)
+        side |= 1UL << (goal_x & 63);
+    return side & maze_open_word(map, y, i);
+}
+
+/*
+* Run from (x, y) in direction d until a square where the path may turn
+* (a side opening) or the goal: that square is the jump point, returned
+* as a square number. -1 when the run ends in a wall first, a dead end
+* no shortest path goes into.
+*/
+static int jump(int x, int y, int d)
+{
+    const uint64_t *row = maze_row(map, y);
+
+    if (d == 1) {
+        // walls and stops of each word, lowest bit past x first
+        for (int p = x + 1; p < map->width; p = (p | 63) + 1) {
+            int i = p >> 6;
+            uint64_t hit = (row[i] | side_openings(y, i)) & (~0UL << (p & 63));
+            if (hit) {
+                int q = 64 * i + __builtin_ctzl(hit);
+                return (row[i] >> (q & 63)) & 1 ? -1 : y * map->width + q;
+            }
+        }
+        return -1;
+    }
+    if (d == 3) {
+        for (int p = x - 1; p >= 0; p = (p & ~63) - 1) {
+            int i = p >> 6;
+            uint64_t hit = (row[i] | side_openings(y, i)) & (~0UL >> (63 - (p & 63)));
+            if (hit) {
+                int q = 64 * i + 63 - __builtin_clzl(hit);
+                return (row[i] >> (q & 63)) & 1 ? -1 : y * map->width + q;
+            }
+        }
+        return -1;
+    }
+    while (1) {
+        y += dir_y[d];
+        if (maze_wall(map, x, y))
+            return -1;
+        if ((x == goal_x && y == goal_y) || !maze_wall(map, x - 1, y) || !maze_wall(map, x + 1, y))
+            return y * map->width + x;
+    }
+}
+
+/* Walk back from the goal through the parents, filling every square in between */
+static int path_build(int start, int goal, int *path, int max)
+{
+    int length = g[goal] + 1;
+    int i = length - 1;
+    unsigned int sq = goal;
+
+    if (path == NULL || length > max)
+        return length;
+    path[i] = sq;
+    while (sq != (unsigned int)start) {
+        unsigned int p = parent[sq];
+        int step = p / map->width == sq / map->width ? 1 : map->width;
+        if (p < sq)
+            step = -step;
+        for (; sq != p; sq += step)
+            path[--i] = sq + step;
+    }
+    return length;
+}
+
+static int search(const maze_map *m, int start, int goal, int *path, int max,
+                  path_result *r, int jps)
+{
+    int squares = m->width * m->height;
+
+    r->length = 0;
+    r->expanded = 0;
+    if (squares > PATH_MAX_SQUARES || start < 0 || goal < 0 || start >= squares || goal >= squares)
+        return 0;
+    map = m;
+    goal_x = goal % m->width;
+    goal_y = goal / m->width;
+    for (int i = 0; i < (squares + 63) / 64; i++) {
+        seen[i] = 0;
+        closed[i] = 0;
+    }
+    if (maze_wall(m, start % m->width, start / m->width) || maze_wall(m, goal_x, goal_y))
+        return 0;
+
+    heap_n = 0;
+    relax(start, start, 0);
+    while (heap_n > 0) {
+        unsigned int sq = heap_pop();
+        BIT_SET(closed, sq);
+        r->expanded++;
+        if (sq == (unsigned int)goal) {
+            r->length = path_build(start, goal, path, max);
+            return 1;
+        }
+
+        int x = sq % m->width, y = sq / m->width;
+        int back = arrived(sq);
+        back = back < 0 ? -1 : (back + 2) & 3;
+        for (int d = 0; d < 4; d++) {
+            if (d == back)
+                continue;
+            if (jps) {
+                int next = jump(x, y, d);
+                if (next >= 0)
+                    relax(next, sq, g[sq] + distance(sq, next));
+            } else if (!maze_wall(m, x + dir_x[d], y + dir_y[d])) {
+                relax((y + dir_y[d]) * m->width + x + dir_x[d], sq, g[sq] + 1);
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+* A* from square start to square goal (y * width + x). On success fills
+* path with the squares from start to goal (when they fit in max) and
+* returns 1; returns 0 when there is no path or the maze is larger than
+* PATH_MAX_SQUARES. r gets the length and the number of expansions.
+*/
+int path_astar(const maze_map *m, int start, int goal, int *path, int max, path_result *r)
+{
+    PROF_SCOPE("path_astar");
+    return search(m, start, goal, path, max, r, 0);
+}
+
+/**
+* Jump point search: same result as path_astar(), with the squares
+* between jump points filled in.
+*/
+int path_jps(const maze_map *m, int start, int goal, int *path, int max, path_result *r)
+{
+    PROF_SCOPE("path_jps");
+    return search(m, start, goal, path, max, r, 1);
+}
+
+/* ------------------------------- distance fields ------------------------------- */
+
+/*
+* Bit-parallel BFS state. Frontier, next frontier and visited are bit
+* rows like the maze's, with a zero guard word at each end of a row and a
+* zero guard row above and below, so neighbours never need a bounds test.
+* For each row, a mask says which of its words hold frontier bits; both
+* frontier buffers stay zero outside those words.
+*/
+#define FIELD_MAX_ROWS (PATH_FIELD_WORDS / 3)
+
+static uint64_t field_front[2][PATH_FIELD_WORDS];
+static uint64_t field_seen[PATH_FIELD_WORDS];
+static uint64_t field_words[2][FIELD_MAX_ROWS + 2];  // frontier words of each row
+static int field_rows[2][FIELD_MAX_ROWS];            // rows with frontier words
+
+/* Give every square set in bits the distance level; base is the square of bit 0 */
+static inline void field_store(unsigned int *dist, int base, uint64_t bits, unsigned int level)
+{
+    while (bits) {
+        dist[base + __builtin_ctzl(bits)] = level;
+        bits &= bits - 1;
+    }
+}
+
+/* The squares next to the frontier around word i: open and not visited yet */
+static inline uint64_t field_next_word(const uint64_t *walls, const uint64_t *front,
+                                       const uint64_t *seen, int i, int stride)
+{
+    uint64_t c = front[i];
+    uint64_t n = front[i - stride] | front[i + stride]
+               | c << 1 | front[i - 1] >> 63
+               | c >> 1 | front[i + 1] << 63;
+    return n & ~walls[i] & ~seen[i];
+}
+
+/*
+* One row of a BFS step, over the words in cand (those next to a frontier
+* word): the squares reached are written to next, marked visited and
+* given the distance level. Returns the mask of words that got any.
+*/
+static uint64_t field_step_row(const uint64_t *walls, const uint64_t *front, uint64_t *next,
+                               uint64_t *seen, int words, int stride, uint64_t cand,
+                               unsigned int *dist, int base, unsigned int level)
+{
+    uint64_t got = 0;
+
+#ifdef __ARM_NEON
+    // wide rows: word pairs 2k, 2k + 1 with one candidate or both, two words per instruction
+    if (words >= 2) {
+        uint64_t pairs = (cand | cand >> 1) & 0x5555555555555555UL;
+        while (pairs) {
+            int i = __builtin_ctzl(pairs);
+            pairs &= pairs - 1;
+            if (i + 1 == words) {
+                uint64_t n = field_next_word(walls, front, seen, i, stride);
+                next[i] = n;
+                seen[i] |= n;
+                field_store(dist, base + 64 * i, n, level);
+                got |= (uint64_t)(n != 0) << i;
+                continue;
+            }
+            // front[i - 1] and front[i + 2] may be the guards at the row ends
+            uint64x2_t c = vld1q_u64(front + i);
+            uint64x2_t west = vld1q_u64(front + i - 1);
+            uint64x2_t east = vld1q_u64(front + i + 1);
+            uint64x2_t n = vorrq_u64(vld1q_u64(front + i - stride), vld1q_u64(front + i + stride));
+            n = vorrq_u64(n, vorrq_u64(vshlq_n_u64(c, 1), vshrq_n_u64(west, 63)));
+            n = vorrq_u64(n, vorrq_u64(vshrq_n_u64(c, 1), vshlq_n_u64(east, 63)));
+            n = vbicq_u64(vbicq_u64(n, vld1q_u64(walls + i)), vld1q_u64(seen + i));
+            vst1q_u64(next + i, n);
+            vst1q_u64(seen + i, vorrq_u64(vld1q_u64(seen + i), n));
+
+            uint64_t n0 = vgetq_lane_u64(n, 0), n1 = vgetq_lane_u64(n, 1);
+            field_store(dist, base + 64 * i, n0, level);
+            field_store(dist, base + 64 * (i + 1), n1, level);
+            got |= (uint64_t)(n0 != 0) << i | (uint64_t)(n1 != 0) << (i + 1);
+        }
+        return got;
+    }
+#endif
+    while (cand) {
+        int i = __builtin_ctzl(cand);
+        cand &= cand - 1;
+        uint64_t n = field_next_word(walls, front, seen, i, stride);
+        next[i] = n;
+        seen[i] |= n;
+        field_store(dist, base + 64 * i, n, level);
+        got |= (uint64_t)(n != 0) << i;
+    }
+    return got;
+}
+
+/* A word mask with the words on either side added */
+static inline uint64_t field_spread(uint64_t m)
+{
+    return m | m << 1 | m >> 1;
+}
+
+/**
+* Distance in steps from every square of the maze to target, by a
+* bit-parallel BFS: each step grows the whole frontier at once with shifts
+* and AND-NOT against the wall bits, a row word (two with NEON) at a time.
+* Only the words next to frontier words are visited, so a step costs in
+* proportion to the frontier, not to the maze.
+* Squares that cannot be reached get PATH_UNREACHED. Returns the number
+* of squares reached, 0 when the maze does not fit PATH_FIELD_WORDS or is
+* wider than 64 row words.
+*/
+int path_distances(const maze_map *m, int target, unsigned int *dist)
+{
+    PROF_SCOPE("path_distances");
+    int words = m->words, stride = words + 2;
+    int size = (m->height + 2) * stride;
+    int squares = m->width * m->height;
+    int tx = target % m->width, ty = target / m->width;
+    uint64_t row_words = words == 64 ? ~0UL : (1UL << words) - 1;
+
+    if (size > PATH_FIELD_WORDS || words > 64 || target < 0 || target >= squares)
+        return 0;
+    for (int i = 0; i < squares; i++)
+        dist[i] = PATH_UNREACHED;
+    if (maze_wall(m, tx, ty))
+        return 0;
+    for (int i = 0; i < size; i++) {
+        field_front[0][i] = 0;
+        field_front[1][i] = 0;
+        field_seen[i] = 0;
+    }
+    for (int y = 0; y < m->height + 2; y++) {
+        field_words[0][y] = 0;
+        field_words[1][y] = 0;
+    }
+
+    // row y of a buffer starts at (y + 1) * stride + 1, its word mask at y + 1
+    uint64_t *front = field_front[0] + stride + 1, *next = field_front[1] + stride + 1;
+    uint64_t *seen = field_seen + stride + 1;
+    uint64_t *act = field_words[0] + 1, *next_act = field_words[1] + 1;
+    int *rows = field_rows[0], *next_rows = field_rows[1];
+    int count = 1, reached = 1;
+
+    front[ty * stride + (tx >> 6)] = 1UL << (tx & 63);
+    seen[ty * stride + (tx >> 6)] = 1UL << (tx & 63);
+    act[ty] = 1UL << (tx >> 6);
+    dist[target] = 0;
+    rows[0] = ty;
+
+    for (unsigned int level = 1; count > 0; level++) {
+        int next_count = 0, last = -1;
+
+        // the rows next to a frontier row, in order and once each
+        for (int k = 0; k < count; k++) {
+            for (int y = rows[k] - 1; y <= rows[k] + 1; y++) {
+                if (y <= last || y < 0 || y >= m->height)
+                    continue;
+                last = y;
+                uint64_t cand = (field_spread(act[y]) | act[y - 1] | act[y + 1]) & row_words;
+                next_act[y] = field_step_row(maze_row(m, y), front + y * stride, next + y * stride,
+                                             seen + y * stride, words, stride, cand,
+                                             dist, y * m->width, level);
+                if (next_act[y]) {
+                    next_rows[next_count++] = y;
+                    for (uint64_t w = next_act[y]; w; w &= w - 1)
+                        reached += __builtin_popcountl(next[y * stride + __builtin_ctzl(w)]);
+                }
+            }
+        }
+
+        // the old frontier goes, the new one takes its place
+        for (int k = 0; k < count; k++) {
+            int y = rows[k];
+            for (uint64_t w = act[y]; w; w &= w - 1)
+                front[y * stride + __builtin_ctzl(w)] = 0;
+            act[y] = 0;
+        }
+        uint64_t *t = front;
+        front = next;
+        next = t;
+        uint64_t *a = act;
+        act = next_act;
+        next_act = a;
+        int *r = rows;
+        rows = next_rows;
+        next_rows = r;
+        count = next_count;
+    }
+    return reached;
+}
+
+/**
+* The same distances with a plain queue BFS, one square at a time: the
+* reference path_distances() is measured against.
+*/
+int path_distances_queue(const maze_map *m, int target, unsigned int *dist)
+{
+    PROF_SCOPE("path_distances_queue");
+    int squares = m->width * m->height;
+    unsigned int *queue = parent; // the A* node pool is free between searches
+    int head = 0, tail = 0;
+
+    if (squares > PATH_MAX_SQUARES || target < 0 || target >= squares)
+        return 0;
+    for (int i = 0; i < squares; i++)
+        dist[i] = PATH_UNREACHED;
+    if (maze_wall(m, target % m->width, target / m->width))
+        return 0;
+
+    dist[target] = 0;
+    queue[tail++] = target;
+    while (head < tail) {
+        unsigned int sq = queue[head++];
+        int x = sq % m->width, y = sq / m->width;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + dir_x[d], ny = y + dir_y[d];
+            if (maze_wall(m, nx, ny))
+                continue;
+            unsigned int n = ny * m->width + nx;
+            if (dist[n] == PATH_UNREACHED) {
+                dist[n] = dist[sq] + 1;
+                queue[tail++] = n;
+            }
+        }
+    }
+    return tail;
+}
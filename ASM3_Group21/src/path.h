@@ -0,0 +1,45 @@
+// -----------------------------------path.h -------------------------------------
+#ifndef PATH_H
+#define PATH_H
+
+#include "Maze.h"
+
+/*
+* Shortest paths between two squares of a maze, 4-connected, every step
+* costing 1. Both searches are A* with the Manhattan distance, a binary
+* heap with decrease-key as the open list, visited and closed bitsets, and
+* a node pool preallocated for PATH_MAX_SQUARES squares: nothing is
+* allocated or cleared per square when a search starts, only the bitsets.
+*
+* path_jps() is the jump point search variant for uniform grids: from a
+* node it runs straight on until a square with a side opening (or the
+* goal), so the heap only ever sees junctions. In a maze this skips whole
+* corridors; horizontal runs go a 64-square row word at a time.
+*/
+#define PATH_MAX_SQUARES (1024 * 1024)
+
+/*
+* Distance fields: the number of steps from every square to one target,
+* for enemies, placing a far destination or rating a maze.
+* path_distances() runs a bit-parallel BFS over the row words (NEON for
+* rows wider than 64 squares), visiting only the words next to the
+* frontier. Its bit rows, plus a guard word at each row end and a guard
+* row above and below, must fit PATH_FIELD_WORDS words, and a row at most
+* 64 words; path_distances_queue() is the one-square-at-a-time BFS for
+* anything larger.
+*/
+#define PATH_FIELD_WORDS (128 * 1024)
+#define PATH_UNREACHED 0xFFFFFFFFu
+
+typedef struct {
+    int length;             // squares on the path, start and goal included; 0 when there is none
+    unsigned long expanded; // nodes taken off the open list
+} path_result;
+
+/* Function prototypes */
+int path_astar(const maze_map *m, int start, int goal, int *path, int max, path_result *r);
+int path_jps(const maze_map *m, int start, int goal, int *path, int max, path_result *r);
+int path_distances(const maze_map *m, int target, unsigned int *dist);
+int path_distances_queue(const maze_map *m, int target, unsigned int *dist);
+
+#endif
@@ -0,0 +1,179 @@
+// -----------------------------------perf.c -------------------------------------
+#include "perf.h"
+#include "mbox.h"
+#include "propcache.h"
+#include "irq.h"
+#include "clock.h"
+#include "printf.h"
+#include "string.h"
+#include "../uart/uart.h"
+
+static const char *perf_mode_names[] = { "auto", "max", "min" };
+
+static struct {
+    int mode;
+    int boost;                  // nesting depth of perf_boost()
+    int hot;                    // backed off because of the temperature
+    unsigned int backoffs;      // times we backed off
+    unsigned int arm_target;    // last ARM rate requested (Hz)
+    volatile unsigned int arm_rate; // ARM rate the firmware reported back
+    volatile int temp;          // last SoC temperature, -1 when unknown
+    volatile int poll_pending;  // temperature request in flight
+    unsigned long last_poll;    // counter value of the last reading
+} perf;
+
+static unsigned int perf_temp_limit()
+{
+    unsigned int limit = props_get()->temp_max;
+    return limit ? limit : PERF_TEMP_LIMIT;
+}
+
+static void perf_rate_done(mbox_req *req, int ok, void *view)
+{
+    if (ok && mbox_tag_ok(view))
+        perf.arm_rate = ((volatile mbox_clock *)view)->rate;
+}
+
+/**
+* Request the ARM rate the mode, boost and temperature call for
+* (asynchronous; safe from IRQ context)
+*/
+static void perf_apply()
+{
+    const board_props *p = props_get();
+    unsigned int target = p->clock_min[MBOX_CLK_ARM];
+
+    if (!perf.hot && (perf.mode == PERF_MAX || (perf.mode == PERF_AUTO && perf.boost > 0)))
+        target = p->clock_max[MBOX_CLK_ARM];
+    if (target == 0)
+        return; // rates unknown
+
+    unsigned long flags = irq_save();
+    if (target != perf.arm_target) {
+        mbox_req *req = mbox_req_alloc();
+        if (req) {
+            // skip turbo: the core clock must stay put for the mini UART baud rate
+            volatile mbox_clock *rate = mbox_set_clock_rate(&req->msg, MBOX_CLK_ARM, target, 1);
+            perf.arm_target = target;
+            mbox_submit(req, perf_rate_done, (void *)rate);
+        }
+    }
+    irq_restore(flags);
+}
+
+static void perf_temp_done(mbox_req *req, int ok, void *view)
+{
+    volatile mbox_sensor *temp = view;
+    int limit = perf_temp_limit();
+
+    perf.poll_pending = 0;
+    if (!ok || !mbox_tag_ok(view)) {
+        perf.temp = -1;
+        return;
+    }
+    perf.temp = temp->value;
+    if (!perf.hot && perf.temp >= limit - PERF_TEMP_MARGIN) {
+        perf.hot = 1;
+        perf.backoffs++;
+    } else if (perf.hot && perf.temp < limit - 2 * PERF_TEMP_MARGIN) {
+        perf.hot = 0;
+    }
+    perf_apply();
+}
+
+void perf_init()
+{
+    perf.mode = PERF_AUTO;
+    perf.temp = -1;
+    perf_apply();
+}
+
+void perf_set_mode(int mode)
+{
+    perf.mode = mode;
+    perf_apply();
+}
+
+/**
+* Run at the maximum rate (in auto mode) until the matching perf_release()
+*/
+void perf_boost()
+{
+    perf.boost++;
+    perf_apply();
+    perf.last_poll = 0;
+    perf_poll();
+}
+
+void perf_release()
+{
+    if (perf.boost > 0)
+        perf.boost--;
+    perf_apply();
+}
+
+/**
+* Read the temperature if PERF_POLL_MS have passed (asynchronous: the
+* response adjusts the rate from the mailbox IRQ)
+*/
+void perf_poll()
+{
+    unsigned long now = now_cycles();
+
+    if (perf.poll_pending || (perf.last_poll && now - perf.last_poll < us_to_cycles(PERF_POLL_MS * 1000)))
+        return;
+    mbox_req *req = mbox_req_alloc();
+    if (req == NULL)
+        return;
+    perf.last_poll = now;
+    perf.poll_pending = 1;
+    volatile mbox_sensor *temp = mbox_get_temperature(&req->msg);
+    mbox_submit(req, perf_temp_done, (void *)temp);
+}
+
+static void perf_show_clock(const char *name, volatile mbox_clock *now, unsigned int id)
+{
+    const board_props *p = props_get();
+    printf("%-11s %10u Hz (min %u, max %u)\n", name, mbox_tag_ok(now) ? now->rate : 0,
+           p->clock_min[id], p->clock_max[id]);
+}
+
+/**
+* perf            show the governor state
+* perf <mode>     switch to auto, max or min
+*/
+void perf_command(const char *arg)
+{
+    if (arg) {
+        int mode = -1;
+        for (int i = 0; i < 3; i++)
+            if (strcmp(arg, perf_mode_names[i]) == 0)
+                mode = i;
+        if (mode < 0) {
+            uart_puts("Unknown mode. Use auto, max or min.\n");
+            return;
+        }
+        perf_set_mode(mode);
+    }
+
+    mbox_msg m;
+    mbox_msg_init(&m, mBuf, MBOX_BUF_WORDS);
+    volatile mbox_clock *arm = mbox_get_clock_rate(&m, MBOX_CLK_ARM);
+    volatile mbox_clock *core = mbox_get_clock_rate(&m, MBOX_CLK_CORE);
+    volatile mbox_sensor *temp = mbox_get_temperature(&m);
+    if (!mbox_msg_send(&m)) {
+        uart_puts("Unable to query!\n");
+        return;
+    }
+
+    printf("Mode: %s%s%s, backed off %u times\n", perf_mode_names[perf.mode],
+           perf.boost ? ", boosted" : "", perf.hot ? ", too hot" : "", perf.backoffs);
+    perf_show_clock("ARM clock:", arm, MBOX_CLK_ARM);
+    perf_show_clock("Core clock:", core, MBOX_CLK_CORE);
+    unsigned int limit = perf_temp_limit();
+    if (mbox_tag_ok(temp))
+        printf("Temperature: %u.%u C (throttles at %u.%u C)\n", temp->value / 1000,
+               temp->value % 1000 / 100, limit / 1000, limit % 1000 / 100);
+    else
+        uart_puts("Temperature: unknown\n");
+}
@@ -0,0 +1,33 @@
+// -----------------------------------perf.h -------------------------------------
+#ifndef PERF_H
+#define PERF_H
+
+/*
+* Performance governor: sets the ARM clock through the mailbox.
+* Heavy commands bracket their work with perf_boost()/perf_release() and
+* call perf_poll() regularly, which watches the SoC temperature and drops
+* to the minimum rate before the firmware starts throttling.
+*/
+
+/* Modes */
+#define PERF_AUTO 0 //maximum while a heavy command runs, minimum otherwise
+#define PERF_MAX  1 //always maximum
+#define PERF_MIN  2 //always minimum
+
+/* Back off this close to the firmware's throttling temperature
+   (thousandths of a degree C), boost again once it is twice as far */
+#define PERF_TEMP_MARGIN 5000
+/* Throttling temperature when the firmware does not report one */
+#define PERF_TEMP_LIMIT 85000
+/* Interval between temperature readings in perf_poll() */
+#define PERF_POLL_MS 500
+
+/* Function prototypes */
+void perf_init();
+void perf_set_mode(int mode);
+void perf_boost();
+void perf_release();
+void perf_poll();
+void perf_command(const char *arg);
+
+#endif
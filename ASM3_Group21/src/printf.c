@@ -1,279 +1,418 @@
 #include "printf.h"
 #include "../uart/uart.h"
+#include "framebf.h"
+#include "numfmt.h"
 
-#define MAX_PRINT_SIZE 256
+// Size of the staging buffers used by printf/fb_printf (chunk sent per flush)
+#define PRINT_CHUNK_SIZE 64
 
+// Longest converted number (64-bit decimal with sign)
+#define NUM_BUFFER_SIZE NUMFMT_MAX_CHARS
 
-void printf(char *string,...) {
+// Format flags
+#define FLAG_LEFT   (1 << 0)	// '-': left justify
+#define FLAG_ZERO   (1 << 1)	// '0': pad with zeros
+#define FLAG_PLUS   (1 << 2)	// '+': always print a sign
+#define FLAG_SPACE  (1 << 3)	// ' ': space in place of '+'
 
-	va_list ap;
-	va_start(ap, string);
 
-	char buffer[MAX_PRINT_SIZE];
-	int buffer_index = 0;
+/**
+ * Hand the staged characters to the sink's target
+ */
+void sink_flush(sink *s) {
+	if (s->len > 0) {
+		s->flush(s, s->buf, s->len);
+		s->len = 0;
+	}
+}
 
-	char temp_buffer[MAX_PRINT_SIZE];
+static void sink_putc(sink *s, char c) {
+	if (s->len == s->size)
+		sink_flush(s);
+	s->buf[s->len++] = c;
+	s->count++;
+}
 
-	while(1) {
-		if (*string == 0)
-			break;
+static void sink_write(sink *s, const char *data, int len) {
+	while (len > 0) {
+		if (s->len == s->size)
+			sink_flush(s);
+		int n = s->size - s->len;
+		if (n > len)
+			n = len;
+		for (int i = 0; i < n; i++)
+			s->buf[s->len + i] = data[i];
+		s->len += n;
+		s->count += n;
+		data += n;
+		len -= n;
+	}
+}
 
-		if (*string == '%') {
-			string++;
+static void sink_fill(sink *s, char c, int n) {
+	while (n-- > 0)
+		sink_putc(s, c);
+}
+
+
+/* ----------------------------------- sinks ------------------------------------- */
+
+static void uart_sink_flush(sink *s, const char *data, int len) {
+	uart_putn(data, len);
+}
+
+/**
+ * Sink writing to the serial console (newlines become "\r\n")
+ */
+void sink_uart(sink *s, char *buf, int size) {
+	s->flush = uart_sink_flush;
+	s->buf = buf;
+	s->size = size;
+	s->len = 0;
+	s->count = 0;
+	s->ctx = NULL;
+}
+
+static void fb_sink_flush(sink *s, const char *data, int len) {
+	fb_cursor *cur = (fb_cursor *)s->ctx;
+	for (int i = 0; i < len; i++) {
+		if (data[i] == '\n') {
+			cur->x = cur->left;
+			cur->y += 8;
+		} else if (data[i] == '\r') {
+			cur->x = cur->left;
+		} else {
+			drawChar(data[i], cur->x, cur->y, cur->attr);
+			cur->x += 8;
+		}
+	}
+}
+
+/**
+ * Sink drawing text on the framebuffer at (and advancing) the given cursor
+ */
+void sink_fb(sink *s, char *buf, int size, fb_cursor *cursor) {
+	s->flush = fb_sink_flush;
+	s->buf = buf;
+	s->size = size;
+	s->len = 0;
+	s->count = 0;
+	s->ctx = cursor;
+}
+
+// Once the destination of a memory sink is full, the rest goes here (and is dropped)
+static char mem_discard[16];
+
+static void mem_sink_flush(sink *s, const char *data, int len) {
+	// data is already in place, keep counting without storing
+	s->buf = mem_discard;
+	s->size = sizeof(mem_discard);
+}
 
-			int zero_pad = 0;
-			if (*string == '0') {
-				zero_pad = 1;
+/**
+ * Sink writing into memory: at most n - 1 characters are stored in dest,
+ * the rest is only counted. Call sink_flush() and terminate at the end
+ * (see vsnprintf).
+ */
+void sink_mem(sink *s, char *dest, size_t n) {
+	s->flush = mem_sink_flush;
+	s->buf = n > 1 ? dest : mem_discard;
+	s->size = n > 1 ? (int)(n - 1) : (int)sizeof(mem_discard);
+	s->len = 0;
+	s->count = 0;
+	s->ctx = dest;
+}
+
+static void count_sink_flush(sink *s, const char *data, int len) {
+}
+
+/**
+ * Sink that only counts the characters produced
+ */
+void sink_count(sink *s) {
+	s->flush = count_sink_flush;
+	s->buf = mem_discard;
+	s->size = sizeof(mem_discard);
+	s->len = 0;
+	s->count = 0;
+	s->ctx = NULL;
+}
+
+
+/* ----------------------------------- formatter ------------------------------------- */
+
+/**
+ * Emit prefix and digits with the requested width, precision and flags
+ */
+static void emit_number(sink *s, const char *prefix, const char *digits, int len,
+                        int width, int precision, int flags) {
+	int prefix_len = 0;
+	while (prefix[prefix_len])
+		prefix_len++;
+
+	// precision: minimum number of digits
+	int zeros = precision > len ? precision - len : 0;
+	int pad = width - prefix_len - zeros - len;
+
+	if (!(flags & FLAG_LEFT) && !(flags & FLAG_ZERO))
+		sink_fill(s, ' ', pad);
+	sink_write(s, prefix, prefix_len);
+	if (!(flags & FLAG_LEFT) && (flags & FLAG_ZERO))
+		sink_fill(s, '0', pad);
+	sink_fill(s, '0', zeros);
+	sink_write(s, digits, len);
+	if (flags & FLAG_LEFT)
+		sink_fill(s, ' ', pad);
+}
+
+/**
+ * Format a double with a fixed number of decimals (exact, see numfmt.c)
+ */
+static void emit_float(sink *s, double value, int width, int precision, int flags) {
+	char temp_buffer[NUMFMT_DOUBLE_CHARS];
+	const char *sign = "";
+	int negative;
+
+	int len = fmt_double_fixed(temp_buffer, value, precision, &negative);
+	if (negative)
+		sign = "-";
+	else if (flags & FLAG_PLUS)
+		sign = "+";
+	else if (flags & FLAG_SPACE)
+		sign = " ";
+
+	// inf and nan are never zero padded
+	if (temp_buffer[0] == 'i' || temp_buffer[0] == 'n')
+		flags &= ~FLAG_ZERO;
+
+	emit_number(s, sign, temp_buffer, len, width, 0, flags);
+}
+
+/**
+ * Format into a sink. Supports %d %i %u %x %X %p %c %s %f %% with
+ * flags '-', '0', '+', ' ', width and precision (numbers or '*')
+ * and the length modifiers h, l, ll, z.
+ */
+int vformat(sink *s, const char *string, va_list ap) {
+	char num_buffer[NUM_BUFFER_SIZE];
+	char *num_end = num_buffer + NUM_BUFFER_SIZE;
+
+	while (*string) {
+		if (*string != '%') {
+			// copy the literal run up to the next conversion in one go
+			const char *start = string;
+			while (*string && *string != '%')
 				string++;
-			}
+			sink_write(s, start, string - start);
+			continue;
+		}
+		string++;
+
+		// Parse flags
+		int flags = 0;
+		while (1) {
+			if (*string == '-')
+				flags |= FLAG_LEFT;
+			else if (*string == '0')
+				flags |= FLAG_ZERO;
+			else if (*string == '+')
+				flags |= FLAG_PLUS;
+			else if (*string == ' ')
+				flags |= FLAG_SPACE;
+			else
+				break;
+			string++;
+		}
 
-			// Parse width specifier
-			int width = 0;
+		// Parse width specifier (either from format string or as an argument)
+		int width = 0;
+		if (*string == '*') {
+			width = va_arg(ap, int);
+			if (width < 0) {
+				flags |= FLAG_LEFT;
+				width = -width;
+			}
+			string++;
+		} else {
 			while (*string >= '0' && *string <= '9') {
 				width = width * 10 + (*string - '0');
 				string++;
 			}
+		}
 
-			// Parse width specifier (either from format string or as an argument)
+		// Parse precision specifier (either from format string or as an argument)
+		int precision = -1; // Default precision value
+		if (*string == '.') {
+			string++;
 			if (*string == '*') {
-				width = va_arg(ap, int);
+				precision = va_arg(ap, int);
 				string++;
 			} else {
+				precision = 0;
 				while (*string >= '0' && *string <= '9') {
-					width = width * 10 + (*string - '0');
+					precision = precision * 10 + (*string - '0');
 					string++;
 				}
 			}
+		}
 
-			// Parse precision specifier (either from format string or as an argument)
-			int precision = -1; // Default precision value
-			if (*string == '.') {
+		// Parse length modifier: 0 = int, 1 = long, 2 = long long
+		int length = 0;
+		if (*string == 'h') {
+			string++;
+			if (*string == 'h')
 				string++;
-				if (*string == '*') {
-			    	precision = va_arg(ap, int);
-					string++;
-				} else {
-					precision = 0;
-					while (*string >= '0' && *string <= '9') {
-						precision = precision * 10 + (*string - '0');
-						string++;
-					}
-				}
-			}
-
-			if (*string == 'd') {
+		} else if (*string == 'l') {
+			length = 1;
+			string++;
+			if (*string == 'l') {
+				length = 2;
 				string++;
-				int x = va_arg(ap, int);
-				int temp_index = MAX_PRINT_SIZE - 1;
-				int isNegative = 0;
-				if (x < 0) {	
-					x = -x;	
-					isNegative = 1;
-				}
-
-				do {
-					temp_buffer[temp_index] = (x % 10) + '0';
-					temp_index--;
-					x /= 10;
-				} while(x != 0);
-				
-				// Print the negative sign if necessary
-				if (isNegative) {
-					temp_buffer[temp_index] = '-';
-					temp_index--; 
-				}
-
-				// Determine the padding character
-				char padding_char = zero_pad ? '0' : ' ';
-
-				// Apply padding if necessary
-				while (width > (MAX_PRINT_SIZE - temp_index - 1)) {
-					temp_buffer[temp_index] = padding_char;
-					temp_index--;
-				}
+			}
+		} else if (*string == 'z') {
+			length = 1;
+			string++;
+		}
 
-				// Calculate the number of leading zeros needed for padding
-				int num_zeros = precision - (MAX_PRINT_SIZE - temp_index - 1);
-				if (num_zeros < 0) {
-					num_zeros = 0;
-				}	
-
-				// Apply padding with leading zeros
-				while (num_zeros > 0) {
-					temp_buffer[temp_index] = '0';
-					temp_index--;
-					num_zeros--;
-				}
+		char specifier = *string;
+		if (specifier == '\0')
+			break;
+		string++;
+
+		if (specifier == 'd' || specifier == 'i') {
+			long long x;
+			if (length == 2)
+				x = va_arg(ap, long long);
+			else if (length == 1)
+				x = va_arg(ap, long);
+			else
+				x = va_arg(ap, int);
+
+			const char *sign = "";
+			unsigned long long ux = (unsigned long long)x;
+			if (x < 0) {
+				sign = "-";
+				ux = -ux;
+			} else if (flags & FLAG_PLUS) {
+				sign = "+";
+			} else if (flags & FLAG_SPACE) {
+				sign = " ";
+			}
+			char *p = fmt_u64_dec(num_end, ux);
+			emit_number(s, sign, p, num_end - p, width, precision, flags);
+		} else if (specifier == 'u' || specifier == 'x' || specifier == 'X') {
+			unsigned long long x;
+			if (length == 2)
+				x = va_arg(ap, unsigned long long);
+			else if (length == 1)
+				x = va_arg(ap, unsigned long);
+			else
+				x = va_arg(ap, unsigned int);
+
+			char *p = (specifier == 'u') ? fmt_u64_dec(num_end, x)
+			                             : fmt_u64_hex(num_end, x, specifier == 'X', 1);
+			emit_number(s, "", p, num_end - p, width, precision, flags);
+		} else if (specifier == 'p') {
+			unsigned long x = (unsigned long)va_arg(ap, void *);
+			char *p = fmt_u64_hex(num_end, x, 0, 1);
+			emit_number(s, "0x", p, num_end - p, width, precision, flags);
+		} else if (specifier == 'c') {
+			char c = va_arg(ap, int); // char is promoted to int in varargs
+			char padding_char = (flags & FLAG_ZERO) ? '0' : ' ';
+			if (!(flags & FLAG_LEFT))
+				sink_fill(s, padding_char, width - 1);
+			sink_putc(s, c);
+			if (flags & FLAG_LEFT)
+				sink_fill(s, ' ', width - 1);
+		} else if (specifier == 's') {
+			const char *str = va_arg(ap, char *);
+			if (str == NULL)
+				str = "(null)";
+
+			// precision: maximum number of characters
+			int str_length = 0;
+			while (str[str_length] != '\0' && (precision < 0 || str_length < precision))
+				str_length++;
+
+			char padding_char = (flags & FLAG_ZERO) ? '0' : ' ';
+			if (!(flags & FLAG_LEFT))
+				sink_fill(s, padding_char, width - str_length);
+			sink_write(s, str, str_length);
+			if (flags & FLAG_LEFT)
+				sink_fill(s, ' ', width - str_length);
+		} else if (specifier == 'f' || specifier == 'F') {
+			emit_float(s, va_arg(ap, double), width, precision, flags);
+		} else if (specifier == '%') {
+			// Handle percent sign
+			sink_putc(s, '%');
+		}
+	}
 
-				for(int i = temp_index + 1; i < MAX_PRINT_SIZE; i++) {
-					buffer[buffer_index] = temp_buffer[i];
-					buffer_index++;
-				}
+	sink_flush(s);
+	return s->count;
+}
 
-			}
-			else if (*string == 'x') {
-				//WRITE YOUR CODE HERE FOR HEXA FORMAT
-				//Then continue with other formats
-                // Handle hexadecimal format specifier
-                string++;
-                unsigned int x = va_arg(ap, unsigned int);
-                int temp_index = MAX_PRINT_SIZE - 1;
-
-                do {
-                    int remainder = x % 16;
-                    temp_buffer[temp_index] = (remainder < 10) ? (remainder + '0') : (remainder - 10 + 'a');
-                    temp_index--;
-                    x /= 16;
-                } while (x != 0);
-
-				// Determine the padding character
-				char padding_char = zero_pad ? '0' : ' ';
-
-				// Apply padding if necessary
-				while (width > (MAX_PRINT_SIZE - temp_index - 1)) {
-					temp_buffer[temp_index] = padding_char;
-					temp_index--;
-				}
 
-				// Calculate the number of leading zeros needed for padding
-				int num_zeros = precision - (MAX_PRINT_SIZE - temp_index - 1);
-				if (num_zeros < 0) {
-					num_zeros = 0;
-				}
-				
-				// Apply padding with leading zeros
-				while (num_zeros > 0) {
-					temp_buffer[temp_index] = '0';
-					temp_index--;
-					num_zeros--;
-				}
+/* ----------------------------------- front ends ------------------------------------- */
 
-                for (int i = temp_index + 1; i < MAX_PRINT_SIZE; i++) {
-                    buffer[buffer_index] = temp_buffer[i];
-                    buffer_index++;
-                }
-			} else if (*string == 'c'){
-				string++;
-                char c = va_arg(ap, int); // char is promoted to int in varargs
-				char padding_char = zero_pad ? '0' : ' ';
-                // Handle flags and width
-                for (int i = 0; i < width - 1; i++) {
-					buffer[buffer_index] = padding_char;
-					buffer_index++;
-				}
+void printf(char *string,...) {
+	char buffer[PRINT_CHUNK_SIZE];
+	sink s;
+	va_list ap;
 
-                // Example: Format character
-                buffer[buffer_index] = c;
-                buffer_index++;
-			} else if (*string == 'f'){
-				string++;
-				double float_num = va_arg(ap, double);
-				// Determine the padding character
-				char padding_char = zero_pad ? '0' : ' ';
-				int Precision = (precision >= 0) ? precision : 6; // Default precision is 6
-				if (float_num < 0) {
-					buffer[buffer_index] = '-';
-					buffer_index++;
-					float_num = -float_num;
-				}
+	sink_uart(&s, buffer, sizeof(buffer));
+	va_start(ap, string);
+	vformat(&s, string, ap);
+	va_end(ap);
+}
 
-				// Handle floating-point format specifier
-				int int_part = (int)float_num;
-				double fractional_part = float_num - int_part;
-
-				// Convert the integer part to string
-				int temp_index = MAX_PRINT_SIZE - 1;
-				do {
-					temp_buffer[temp_index] = (int_part % 10) + '0';
-					temp_index--;
-					int_part /= 10;
-				} while (int_part != 0);
-
-				// Apply padding if necessary (before the integer part)
-				int padding_count = width - (MAX_PRINT_SIZE - temp_index - 1) - Precision - 1; // Calculate required padding
-				while (padding_count > 0) {
-					temp_buffer[temp_index] = padding_char;
-					temp_index--;
-					padding_count--;
-				}
+/**
+ * printf onto the framebuffer, starting at (and advancing) cursor
+ */
+void fb_printf(fb_cursor *cursor, char *string,...) {
+	char buffer[PRINT_CHUNK_SIZE];
+	sink s;
+	va_list ap;
 
-				for (int i = temp_index + 1; i < MAX_PRINT_SIZE; i++) {
-					buffer[buffer_index] = temp_buffer[i];
-					buffer_index++;
-				}
-				
-				// Add decimal point
-				buffer[buffer_index] = '.';
-				buffer_index++;
-
-				// Convert the fractional part to string (up to the specified precision)
-				for (int i = 0; i < Precision; i++) {
-					fractional_part *= 10;
-					int digit = (int)fractional_part;
-					buffer[buffer_index] = digit + '0';
-					buffer_index++;
-					fractional_part -= digit;
-				}
+	sink_fb(&s, buffer, sizeof(buffer), cursor);
+	va_start(ap, string);
+	vformat(&s, string, ap);
+	va_end(ap);
+}
 
-				// Round the last digit
-				if (fractional_part >= 0.5) {
-					buffer[buffer_index - 1]++;
-				}
-			} else if (*string == 's'){
-				string++; 
-				char *s = va_arg(ap, char *);
-				int temp_index = 0;
-				int str_length = 0;
-
-				// Calculate the length of the string
-				while (s[str_length] != '\0') {
-					str_length++;
-				}
+/**
+ * Format into dest (always null-terminated when n > 0). Returns the full
+ * length of the formatted text, which may exceed n - 1 when truncated.
+ */
+int vsnprintf(char *dest, size_t n, const char *string, va_list ap) {
+	sink s;
+
+	sink_mem(&s, dest, n);
+	int count = vformat(&s, string, ap);
+	if (n > 0)
+		dest[count < (int)n ? count : (int)n - 1] = '\0';
+	return count;
+}
 
-				// // Determine the padding character
-				char padding_char = zero_pad ? '0' : ' ';
-				// Calculate the padding count
-				// Apply padding if necessary
-				// Calculate the padding count
-				width = width - str_length;
-				for (int i = 0; i < width; i++){
-					temp_buffer[temp_index] = padding_char;
-					temp_index++;
-				}
-				
-				while (*s != '\0') {
-					temp_buffer[temp_index] = *s;
-					temp_index++;
-                    s++;
-                }
-
-				for (int i = 0; i < temp_index; i++) {
-                    buffer[buffer_index] = temp_buffer[i];
-                    buffer_index++;
-                }
-
-			} else if (*string == '%'){
-				// Handle percent sign
-                buffer[buffer_index] = '%';
-                buffer_index++;
-                string++;
-			} else {
-			}
-		}else {
-			buffer[buffer_index] = *string;
-			buffer_index++;
-			string++;
-		}
+int snprintf(char *dest, size_t n, const char *string,...) {
+	va_list ap;
 
-		if (buffer_index == MAX_PRINT_SIZE - 1)
-			break;
-	}
-	
+	va_start(ap, string);
+	int count = vsnprintf(dest, n, string, ap);
 	va_end(ap);
+	return count;
+}
 
-	// Null-terminate the buffer
-	buffer[buffer_index] = '\0';
+/**
+ * Number of characters the formatted text would take
+ */
+int format_length(const char *string,...) {
+	sink s;
+	va_list ap;
 
-	//Print out formated string
-	uart_puts(buffer);
+	sink_count(&s);
+	va_start(ap, string);
+	int count = vformat(&s, string, ap);
+	va_end(ap);
+	return count;
 }
@@ -2,4 +2,41 @@
 #include "../gcclib/stdint.h"
 #include "../gcclib/stdarg.h"
 
-void printf(char *string,...);
\ No newline at end of file
+#ifndef PRINTF_H
+#define PRINTF_H
+
+/* Output sink of the formatter: characters are staged in buf and
+   handed to flush() in chunks whenever buf fills up (and once at the end) */
+typedef struct sink {
+	void (*flush)(struct sink *s, const char *data, int len);
+	char *buf;      // staging buffer
+	int size;       // capacity of buf
+	int len;        // characters currently staged
+	int count;      // total characters produced
+	void *ctx;      // sink specific state
+} sink;
+
+/* Position and colors of text drawn on the framebuffer console */
+typedef struct {
+	int x, y;           // cursor (pixels)
+	int left;           // column a new line returns to
+	unsigned char attr; // foreground (low nibble) / background (high nibble) palette index
+} fb_cursor;
+
+/* Formatter core: returns the number of characters produced */
+int vformat(sink *s, const char *fmt, va_list ap);
+
+/* Sinks */
+void sink_uart(sink *s, char *buf, int size);
+void sink_fb(sink *s, char *buf, int size, fb_cursor *cursor);
+void sink_mem(sink *s, char *dest, size_t n);
+void sink_count(sink *s);
+void sink_flush(sink *s);
+
+void printf(char *string,...);
+void fb_printf(fb_cursor *cursor, char *string,...);
+int snprintf(char *dest, size_t n, const char *string,...);
+int vsnprintf(char *dest, size_t n, const char *string, va_list ap);
+int format_length(const char *string,...);
+
+#endif
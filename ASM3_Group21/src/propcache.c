@@ -0,0 +1,67 @@
+// -----------------------------------propcache.c -------------------------------------
+#include "propcache.h"
+
+/* Message buffer large enough for every cached tag in one round trip */
+#define PROPS_BUF_WORDS 72
+static volatile unsigned int __attribute__((aligned(16))) props_buf[PROPS_BUF_WORDS];
+
+static board_props props;
+static int props_loaded = 0;
+
+/* Clocks whose rate range is cached */
+static const unsigned int props_clocks[] = { MBOX_CLK_UART, MBOX_CLK_ARM, MBOX_CLK_CORE };
+#define PROPS_CLOCKS (sizeof(props_clocks) / sizeof(props_clocks[0]))
+
+/**
+* Fetch all cached properties in a single mailbox call.
+* Returns 0 on failure, non-zero on success
+*/
+int props_init()
+{
+    mbox_msg m;
+    volatile mbox_clock *min[PROPS_CLOCKS], *max[PROPS_CLOCKS];
+
+    mbox_msg_init(&m, props_buf, PROPS_BUF_WORDS);
+    volatile mbox_value *revision = mbox_get_board_revision(&m);
+    volatile mbox_value *firmware = mbox_get_firmware(&m);
+    volatile mbox_mac *mac = mbox_get_mac(&m);
+    volatile mbox_serial *serial = mbox_get_serial(&m);
+    volatile mbox_mem *arm = mbox_get_arm_memory(&m);
+    volatile mbox_mem *vc = mbox_get_vc_memory(&m);
+    volatile mbox_sensor *temp_max = mbox_get_max_temperature(&m);
+    for (unsigned int i = 0; i < PROPS_CLOCKS; i++) {
+        min[i] = mbox_get_min_clock_rate(&m, props_clocks[i]);
+        max[i] = mbox_get_max_clock_rate(&m, props_clocks[i]);
+    }
+
+    props_loaded = 1;
+    props.valid = mbox_msg_send(&m);
+    if (!props.valid)
+        return 0;
+
+    props.revision = revision->value;
+    props.firmware = firmware->value;
+    for (int i = 0; i < 6; i++)
+        props.mac[i] = mac->addr[i];
+    props.serial = (unsigned long)serial->high << 32 | serial->low;
+    props.arm_base = arm->base;
+    props.arm_size = arm->size;
+    props.vc_base = vc->base;
+    props.vc_size = vc->size;
+    props.temp_max = temp_max->value;
+    for (unsigned int i = 0; i < PROPS_CLOCKS; i++) {
+        props.clock_min[props_clocks[i]] = min[i]->rate;
+        props.clock_max[props_clocks[i]] = max[i]->rate;
+    }
+    return 1;
+}
+
+/**
+* The cached properties, queried on first use (check valid)
+*/
+const board_props *props_get()
+{
+    if (!props_loaded)
+        props_init();
+    return &props;
+}
@@ -0,0 +1,32 @@
+// -----------------------------------propcache.h -------------------------------------
+#ifndef PROPCACHE_H
+#define PROPCACHE_H
+
+#include "mbox.h"
+
+/*
+* Mailbox properties that never change after boot, fetched in one batched
+* query (at startup or on first use) and then answered from RAM.
+*/
+
+/* Clocks with cached min/max rates (indexed by mailbox clock id) */
+#define PROPS_MAX_CLOCK MBOX_CLK_CORE
+
+typedef struct {
+    int valid;                     // the query succeeded
+    unsigned int revision;         // board revision
+    unsigned int firmware;         // firmware revision
+    unsigned char mac[6];          // MAC address, network byte order
+    unsigned long serial;          // board serial number
+    unsigned int arm_base, arm_size; // memory split: ARM part
+    unsigned int vc_base, vc_size;   // memory split: VideoCore part
+    unsigned int clock_min[PROPS_MAX_CLOCK + 1]; // Hz, 0 when unknown
+    unsigned int clock_max[PROPS_MAX_CLOCK + 1];
+    unsigned int temp_max;         // thousandths of a degree C where the firmware throttles
+} board_props;
+
+/* Function prototypes */
+int props_init();
+const board_props *props_get();
+
+#endif
@@ -0,0 +1,266 @@
+// -----------------------------------sched.c -------------------------------------
+#include "sched.h"
+#include "irq.h"
+#include "clock.h"
+#include "printf.h"
+
+/* sched.S */
+void sched_switch(unsigned long *save_sp, unsigned long next_sp);
+void sched_task_start();
+
+/* Frame pushed by sched_switch: x19-x30, then d8-d15 */
+#define SWITCH_FRAME_WORDS 20
+#define SWITCH_FRAME_X30 11
+
+unsigned long sched_switches = 0;
+
+static task tasks[SCHED_MAX_TASKS];
+static unsigned char stacks[SCHED_MAX_TASKS][SCHED_STACK_SIZE] __attribute__((aligned(16)));
+
+// The boot context: runs when nothing else is ready, never queued
+static task idle_task = { .name = "idle", .state = TASK_READY, .prio = SCHED_PRIOS };
+static task *current = &idle_task;
+
+static task *run_head[SCHED_PRIOS];
+static task *run_tail[SCHED_PRIOS];
+
+static unsigned long switch_start;  // counter when the last switch was decided
+static unsigned long switch_flags;  // IRQ state a new task starts with
+static prof_hist switch_hist = { .name = "ctx_switch" };
+
+static const char *state_names[] = { "free", "ready", "sleep", "dead" };
+
+/* Run queues, IRQs masked */
+
+static void run_push(task *t)
+{
+    t->next = 0;
+    if (run_tail[t->prio])
+        run_tail[t->prio]->next = t;
+    else
+        run_head[t->prio] = t;
+    run_tail[t->prio] = t;
+}
+
+static task *run_pop()
+{
+    for (int p = 0; p < SCHED_PRIOS; p++) {
+        task *t = run_head[p];
+        if (t) {
+            run_head[p] = t->next;
+            if (!run_head[p])
+                run_tail[p] = 0;
+            return t;
+        }
+    }
+    return 0;
+}
+
+static int run_any()
+{
+    for (int p = 0; p < SCHED_PRIOS; p++)
+        if (run_head[p])
+            return 1;
+    return 0;
+}
+
+/* First thing a task does after being switched in */
+static void sched_switched_in()
+{
+    unsigned long now = now_cycles();
+    current->run_since = now;
+    prof_record(&switch_hist, cycles_to_ns(now - switch_start));
+}
+
+/**
+* Switch to the next ready task (IRQs masked, flags as saved by the caller).
+* A ready current task goes to the back of its queue; returns when the
+* current task is switched in again.
+*/
+static void sched_next(unsigned long flags)
+{
+    task *prev = current;
+
+    if (prev->state == TASK_READY && prev != &idle_task)
+        run_push(prev);
+    task *next = run_pop();
+    if (!next)
+        next = &idle_task;
+    if (next == prev)
+        return;
+
+    unsigned long now = now_cycles();
+    prev->run_cycles += now - prev->run_since;
+    sched_switches++;
+    next->switches++;
+    current = next;
+    switch_start = now;
+    switch_flags = flags;
+    sched_switch(&prev->sp, next->sp);
+    sched_switched_in();
+}
+
+/**
+* C entry of a new task (from sched_task_start, with the task in x0)
+*/
+void sched_task_entry(task *t)
+{
+    sched_switched_in();
+    irq_restore(switch_flags);
+
+    t->fn(t->ctx);
+
+    unsigned long flags = irq_save();
+    t->state = TASK_DEAD;
+    sched_next(flags);
+}
+
+void sched_init()
+{
+    idle_task.run_since = now_cycles();
+}
+
+/**
+* Create a ready task running fn(ctx) on its own stack, NULL when all
+* SCHED_MAX_TASKS slots are in use
+*/
+task *task_create(const char *name, task_fn fn, void *ctx, int prio)
+{
+    unsigned long flags = irq_save();
+    task *t = 0;
+    int i;
+
+    for (i = 0; i < SCHED_MAX_TASKS; i++) {
+        if (tasks[i].state == TASK_FREE || tasks[i].state == TASK_DEAD) {
+            t = &tasks[i];
+            break;
+        }
+    }
+    if (t == 0) {
+        irq_restore(flags);
+        return 0;
+    }
+
+    // initial frame: sched_switch "returns" into sched_task_start with x19 = t
+    unsigned long *frame = (unsigned long *)(stacks[i] + SCHED_STACK_SIZE) - SWITCH_FRAME_WORDS;
+    for (int w = 0; w < SWITCH_FRAME_WORDS; w++)
+        frame[w] = 0;
+    frame[0] = (unsigned long)t;
+    frame[SWITCH_FRAME_X30] = (unsigned long)sched_task_start;
+
+    t->sp = (unsigned long)frame;
+    t->name = name;
+    t->state = TASK_READY;
+    t->prio = prio < 0 ? 0 : prio >= SCHED_PRIOS ? SCHED_PRIOS - 1 : prio;
+    t->fn = fn;
+    t->ctx = ctx;
+    t->wake.pprev = 0;
+    t->switches = 0;
+    t->run_cycles = 0;
+    run_push(t);
+    irq_restore(flags);
+    return t;
+}
+
+task *task_current()
+{
+    return current;
+}
+
+/* Running in a task (rather than in the boot/idle context), so it may block */
+int sched_active()
+{
+    return current != &idle_task;
+}
+
+/* Let the other ready tasks of the same or higher priority run */
+void task_yield()
+{
+    unsigned long flags = irq_save();
+    sched_next(flags);
+    irq_restore(flags);
+}
+
+static void task_wake(void *ctx)
+{
+    task *t = (task *)ctx;
+    if (t->state == TASK_SLEEPING) {
+        t->state = TASK_READY;
+        run_push(t);
+    }
+}
+
+/**
+* Block the current task until timer_ms() reaches deadline_ms (absolute,
+* so periodic work does not drift). Outside a task, or with IRQs masked,
+* falls back to sleep_ms().
+*/
+void task_sleep_until(unsigned long deadline_ms)
+{
+    unsigned long now = timer_ms();
+
+    if (!sched_active() || !irq_enabled()) {
+        if (deadline_ms > now)
+            sleep_ms(deadline_ms - now);
+        return;
+    }
+    if (deadline_ms <= now) {
+        task_yield();
+        return;
+    }
+
+    unsigned long flags = irq_save();
+    current->state = TASK_SLEEPING;
+    timer_add(&current->wake, deadline_ms - now, 0, task_wake, current);
+    sched_next(flags);
+    irq_restore(flags);
+}
+
+void task_sleep_ms(unsigned int ms)
+{
+    task_sleep_until(timer_ms() + ms);
+}
+
+/**
+* Idle loop of the boot context: hand the core to the ready tasks, and
+* wait in wfi while there are none. Never returns.
+*/
+void sched_idle()
+{
+    while (1) {
+        unsigned long flags = irq_save();
+        if (!run_any())
+            asm volatile ("wfi"); // wakes up on the pending IRQ even while masked
+        irq_restore(flags);
+        task_yield();
+    }
+}
+
+static void print_task(task *t, unsigned long now)
+{
+    unsigned long run = t->run_cycles;
+    if (t == current)
+        run += now - t->run_since;
+    printf("%-10s %4d %-6s %10lu %10lu\n", t->name, t->prio, state_names[t->state],
+           t->switches, cycles_to_ns(run) / 1000000);
+}
+
+/**
+* `tasks`: every task with its switch count and running time, then the
+* context switch latency
+*/
+void sched_command()
+{
+    unsigned long now = now_cycles();
+
+    printf("name       prio state    switches     run ms\n");
+    for (int i = 0; i < SCHED_MAX_TASKS; i++)
+        if (tasks[i].state != TASK_FREE)
+            print_task(&tasks[i], now);
+    print_task(&idle_task, now);
+
+    printf("context switches: %lu\n", sched_switches);
+    if (switch_hist.count > 0)
+        printf("switch latency ns: min %lu avg %lu max %lu (prof ctx_switch)\n",
+               switch_hist.min_ns, switch_hist.sum_ns / switch_hist.count, switch_hist.max_ns);
+}
@@ -0,0 +1,66 @@
+// -----------------------------------sched.h -------------------------------------
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "timer.h"
+
+/*
+* Cooperative scheduler: stackful tasks switched in sched_switch()
+* (sched.S), which saves only the callee-saved registers.
+*
+* Ready tasks wait in one FIFO run queue per priority; the highest
+* non-empty queue runs, round-robin within it. A task runs until it calls
+* task_yield(), task_sleep_ms()/task_sleep_until() or returns. When no task
+* is ready, the boot context (the idle task) parks the core in wfi until an
+* interrupt wakes a sleeper.
+*
+*   static void blink(void *ctx) {
+*       while (1) { toggle(); task_sleep_ms(500); }
+*   }
+*   task_create("blink", blink, NULL, SCHED_PRIO_NORMAL);
+*/
+#define SCHED_MAX_TASKS 8
+#define SCHED_STACK_SIZE (16 * 1024) //room for the IRQ frame on top of the task
+#define SCHED_PRIOS 3
+
+/* Priorities (lower runs first) */
+#define SCHED_PRIO_HIGH 0
+#define SCHED_PRIO_NORMAL 1
+#define SCHED_PRIO_LOW 2
+
+/* Task states */
+#define TASK_FREE 0
+#define TASK_READY 1    //queued, or running
+#define TASK_SLEEPING 2
+#define TASK_DEAD 3     //returned, slot reclaimed on the next task_create
+
+typedef void (*task_fn)(void *ctx);
+
+typedef struct task {
+    unsigned long sp;           // saved stack pointer while switched out
+    struct task *next;          // run queue link
+    const char *name;
+    int state;
+    int prio;
+    task_fn fn;
+    void *ctx;
+    timer wake;                 // sleep timeout
+    unsigned long switches;     // times switched in
+    unsigned long run_cycles;   // counter ticks spent running
+    unsigned long run_since;
+} task;
+
+extern unsigned long sched_switches; // context switches since sched_init()
+
+/* Function prototypes */
+void sched_init();
+task *task_create(const char *name, task_fn fn, void *ctx, int prio);
+task *task_current();
+int sched_active();
+void task_yield();
+void task_sleep_ms(unsigned int ms);
+void task_sleep_until(unsigned long deadline_ms);
+void sched_idle();
+void sched_command();
+
+#endif
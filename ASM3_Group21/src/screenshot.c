@@ -0,0 +1,163 @@
+// -----------------------------------screenshot.c -------------------------------------
+#include "screenshot.h"
+#include "framebf.h"
+#include "../uart/uart.h"
+#include "clock.h"
+
+/* QOI chunk tags */
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xC0
+#define QOI_OP_RGB   0xFE
+
+/* Worst case tile: every pixel as a 4-byte QOI_OP_RGB chunk */
+#define SHOT_TILE_MAX (FB_TILE_SIZE * FB_TILE_SIZE * 4)
+
+static unsigned int crc_table[256];
+static unsigned int shot_sequence = 0;
+
+static void crc_init()
+{
+    for (unsigned int n = 0; n < 256; n++) {
+        unsigned int c = n;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        crc_table[n] = c;
+    }
+}
+
+static unsigned int crc_update(unsigned int crc, const unsigned char *p, unsigned int len)
+{
+    while (len--)
+        crc = crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+/* Send bytes and fold them into the running CRC */
+static void shot_write(unsigned int *crc, const unsigned char *p, unsigned int len)
+{
+    *crc = crc_update(*crc, p, len);
+    uart_write((const char *)p, len);
+}
+
+/**
+* QOI-encode the w x h block of pixels at (x0, y0). Returns the encoded size.
+*/
+static int qoi_encode_tile(unsigned char *out, int x0, int y0, int w, int h)
+{
+    unsigned int index[64];
+    unsigned int prev = 0xFF000000; // r = g = b = 0, alpha 255
+    int run = 0;
+    int n = 0;
+
+    for (int i = 0; i < 64; i++)
+        index[i] = 0;
+
+    for (int y = 0; y < h; y++) {
+        const unsigned int *row = (const unsigned int *)(fb + (y0 + y) * pitch) + x0;
+        for (int x = 0; x < w; x++) {
+            unsigned int px = row[x] | 0xFF000000;
+
+            if (px == prev) {
+                if (++run == 62) {
+                    out[n++] = QOI_OP_RUN | (run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                out[n++] = QOI_OP_RUN | (run - 1);
+                run = 0;
+            }
+
+            int r = (px >> 16) & 0xFF, g = (px >> 8) & 0xFF, b = px & 0xFF;
+            int hash = (r * 3 + g * 5 + b * 7 + 255 * 11) & 63;
+            if (index[hash] == px) {
+                out[n++] = QOI_OP_INDEX | hash;
+            } else {
+                index[hash] = px;
+                signed char vr = r - ((prev >> 16) & 0xFF);
+                signed char vg = g - ((prev >> 8) & 0xFF);
+                signed char vb = b - (prev & 0xFF);
+                signed char vg_r = vr - vg;
+                signed char vg_b = vb - vg;
+
+                if (vr >= -2 && vr <= 1 && vg >= -2 && vg <= 1 && vb >= -2 && vb <= 1) {
+                    out[n++] = QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+                } else if (vg >= -32 && vg <= 31 && vg_r >= -8 && vg_r <= 7 && vg_b >= -8 && vg_b <= 7) {
+                    out[n++] = QOI_OP_LUMA | (vg + 32);
+                    out[n++] = (vg_r + 8) << 4 | (vg_b + 8);
+                } else {
+                    out[n++] = QOI_OP_RGB;
+                    out[n++] = r;
+                    out[n++] = g;
+                    out[n++] = b;
+                }
+            }
+            prev = px;
+        }
+    }
+    if (run > 0)
+        out[n++] = QOI_OP_RUN | (run - 1);
+    return n;
+}
+
+/**
+* Send the whole screen, or with incremental set only the tiles drawn since
+* the previous screenshot. Either way the dirty tiles are cleared afterwards.
+*/
+void screenshot_send(int incremental)
+{
+    static unsigned char tile[4 + SHOT_TILE_MAX];
+    unsigned char header[16];
+    unsigned int tiles = fb_tiles_x * fb_tiles_y;
+    unsigned int count = 0;
+    unsigned int crc = 0xFFFFFFFF;
+    PROF_SCOPE("screenshot");
+
+    if (fb == 0 || tiles > FB_DIRTY_WORDS * 64) {
+        uart_puts("No frame buffer\n");
+        return;
+    }
+    if (crc_table[1] == 0)
+        crc_init();
+    if (!incremental)
+        fb_dirty_all();
+    for (unsigned int i = 0; i < FB_DIRTY_WORDS; i++)
+        count += __builtin_popcountl(fb_dirty[i]);
+
+    header[0] = 'S'; header[1] = 'H'; header[2] = 'O'; header[3] = 'T';
+    header[4] = width; header[5] = width >> 8;
+    header[6] = height; header[7] = height >> 8;
+    header[8] = FB_TILE_SIZE;
+    header[9] = incremental ? SHOT_INCREMENTAL : 0;
+    header[10] = count; header[11] = count >> 8;
+    header[12] = shot_sequence; header[13] = shot_sequence >> 8;
+    header[14] = shot_sequence >> 16; header[15] = shot_sequence >> 24;
+    shot_sequence++;
+    shot_write(&crc, header, sizeof(header));
+
+    for (unsigned int w = 0; w < FB_DIRTY_WORDS; w++) {
+        unsigned long bits = fb_dirty[w];
+        while (bits) {
+            unsigned int t = w * 64 + __builtin_ctzl(bits);
+            bits &= bits - 1;
+
+            int x0 = (t % fb_tiles_x) * FB_TILE_SIZE;
+            int y0 = (t / fb_tiles_x) * FB_TILE_SIZE;
+            int tw = width - x0 < FB_TILE_SIZE ? width - x0 : FB_TILE_SIZE;
+            int th = height - y0 < FB_TILE_SIZE ? height - y0 : FB_TILE_SIZE;
+            int len = qoi_encode_tile(tile + 4, x0, y0, tw, th);
+
+            tile[0] = t; tile[1] = t >> 8;
+            tile[2] = len; tile[3] = len >> 8;
+            shot_write(&crc, tile, 4 + len);
+        }
+    }
+    fb_dirty_clear();
+
+    crc = ~crc;
+    header[0] = crc; header[1] = crc >> 8; header[2] = crc >> 16; header[3] = crc >> 24;
+    uart_write((const char *)header, 4);
+}
@@ -0,0 +1,25 @@
+// -----------------------------------screenshot.h -------------------------------------
+#ifndef SCREENSHOT_H
+#define SCREENSHOT_H
+
+/*
+* Framebuffer screenshots over the serial console
+*
+* The screen is cut into FB_TILE_SIZE x FB_TILE_SIZE tiles and every tile is
+* compressed on the fly with QOI (https://qoiformat.org, per-tile state, no
+* alpha), so only one tile is ever buffered. Wire format (little endian):
+*   "SHOT" | u16 width | u16 height | u8 tile size | u8 flags | u16 tile count
+*   | u32 sequence number
+*   then per tile: u16 tile index (row * tiles per row + column)
+*                  | u16 encoded length | QOI chunks
+*   then u32 CRC-32 (IEEE) of everything from the magic to the last tile.
+* An incremental shot (flag SHOT_INCREMENTAL) only carries the tiles drawn
+* since the previous screenshot. tools/screenshot.py rebuilds the PNGs.
+*/
+
+#define SHOT_INCREMENTAL 0x01
+
+/* Function prototypes */
+void screenshot_send(int incremental);
+
+#endif
@@ -0,0 +1,191 @@
+// -----------------------------------script.c -------------------------------------
+#include "script.h"
+#include "cmd.h"
+#include "clock.h"
+#include "lineedit.h"
+#include "sched.h"
+#include "printf.h"
+#include "string.h"
+#include "../uart/uart.h"
+
+/* Scripts built into the image */
+static const script scripts[] = {
+    { "selftest",
+      "# board, formatting and scheduler smoke test\n"
+      "showinfo\n"
+      "perf\n"
+      "prof reset\n"
+      "bench\n"
+      "prof\n"
+      "tasks\n" },
+    { "demo",
+      "clear\n"
+      "smallimg\n"
+      "showinfo\n"
+      "video\n" },
+    { "hinttest",
+      "# a game ended from the shell, then its maze solved with both searches\n"
+      "game\n"
+      "game quit\n"
+      "hint\n"
+      "hint astar\n"
+      "game quit\n"
+      "tasks\n" },
+};
+
+static char paste_buf[SCRIPT_BUF_SIZE];
+static char out_buf[SCRIPT_OUT_SIZE];
+static int running = 0;
+
+/**
+* Run the commands of a script, one per line. Returns the number of
+* failed commands, -1 when the script could not be run.
+*/
+int script_run(const char *text)
+{
+    char line[LINE_MAX];
+    int commands = 0, unknown = 0;
+
+    if (running) {
+        uart_puts("script: scripts cannot be nested\n");
+        return -1;
+    }
+    running = 1;
+
+    unsigned long start = now_cycles();
+    uart_batch_begin(out_buf, sizeof(out_buf));
+    while (*text) {
+        int n = 0, too_long = 0;
+        while (*text && *text != '\n') {
+            if (n < LINE_MAX - 1)
+                line[n++] = *text;
+            else
+                too_long = 1;
+            text++;
+        }
+        if (*text)
+            text++;
+
+        // pasted lines may end in "\r" or carry trailing blanks
+        while (n > 0 && (line[n - 1] == '\r' || line[n - 1] == ' '))
+            n--;
+        line[n] = '\0';
+        char *p = line;
+        while (*p == ' ')
+            p++;
+        if (*p == '\0' || *p == '#')
+            continue;
+
+        printf("script> %s\n", p);
+        commands++;
+        if (too_long) {
+            printf("script: line longer than %d characters skipped\n", LINE_MAX - 1);
+            unknown++;
+        } else if (!cmd_execute(p)) {
+            uart_puts("Unrecognized command\n");
+            unknown++;
+        }
+    }
+    // the time includes sending all the output
+    uart_batch_end();
+    uart_flush();
+    unsigned long us = cycles_to_ns(now_cycles() - start) / 1000;
+
+    printf("script: %d commands (%d failed) in %lu.%03lu ms\n",
+           commands, unknown, us / 1000, us % 1000);
+    running = 0;
+    return unknown;
+}
+
+static const script *script_find(const char *name)
+{
+    for (unsigned int i = 0; i < sizeof(scripts) / sizeof(scripts[0]); i++)
+        if (strcmp(scripts[i].name, name) == 0)
+            return &scripts[i];
+    return 0;
+}
+
+/* Run a built-in script, -1 when there is none with that name */
+int script_run_named(const char *name)
+{
+    const script *s = script_find(name);
+    return s ? script_run(s->text) : -1;
+}
+
+/**
+* Read a pasted script into paste_buf. Until the paste starts the UART is
+* polled every INPUT_POLL_MS, like the shell does; once bytes arrive an
+* empty poll only yields, since sleeping would overrun the receive FIFO.
+* Ends on Ctrl-D, a line holding only '.', or SCRIPT_PASTE_IDLE_MS
+* without input once something arrived.
+* Returns the length, -1 when cancelled (Ctrl-C) or too long.
+*/
+static int script_read_paste()
+{
+    unsigned long idle = us_to_cycles(SCRIPT_PASTE_IDLE_MS * 1000UL);
+    unsigned long last = 0;
+    int n = 0, line_start = 0, overflow = 0;
+
+    while (1) {
+        if (!uart_rx_ready()) {
+            if (n > 0 && now_cycles() - last > idle)
+                break;
+            if (n == 0)
+                task_sleep_ms(INPUT_POLL_MS);
+            else if (sched_active())
+                task_yield();
+            continue;
+        }
+        char c = uart_getc();
+        last = now_cycles();
+        if (c == 4) // Ctrl-D
+            break;
+        if (c == 3) { // Ctrl-C
+            uart_puts("^C\n");
+            return -1;
+        }
+        if (n == SCRIPT_BUF_SIZE - 1) {
+            overflow = 1;
+            continue;
+        }
+        paste_buf[n++] = c;
+        if (c == '\n') {
+            if (n - line_start == 2 && paste_buf[line_start] == '.') {
+                n = line_start;
+                break;
+            }
+            line_start = n;
+        }
+    }
+    paste_buf[n] = '\0';
+
+    if (overflow) {
+        printf("script: longer than %d bytes, not run\n", SCRIPT_BUF_SIZE - 1);
+        return -1;
+    }
+    return n;
+}
+
+/**
+* script: read a pasted script and run it
+* script list: show the built-in scripts
+* script <name>: run a built-in script
+*/
+void script_command(const char *arg)
+{
+    if (arg == 0) {
+        uart_puts("Paste the commands, end with Ctrl-D or a line holding only '.'\n");
+        int n = script_read_paste();
+        if (n >= 0) {
+            printf("script: %d bytes received\n", n);
+            script_run(paste_buf);
+        }
+    } else if (strcmp(arg, "list") == 0) {
+        for (unsigned int i = 0; i < sizeof(scripts) / sizeof(scripts[0]); i++)
+            printf("%s\n", scripts[i].name);
+    } else if (script_find(arg) == 0) {
+        printf("script: no script named %s\n", arg);
+    } else {
+        script_run_named(arg);
+    }
+}
@@ -0,0 +1,32 @@
+// -----------------------------------script.h -------------------------------------
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+/*
+* Command scripts: one shell command per line, '#' starts a comment line.
+*
+* Scripts are either built into the image (the scripts[] table in
+* script.c) or pasted over the serial line: `script` with no argument
+* reads the whole paste into memory as fast as it arrives, without echo,
+* and only then runs it, so no input is lost in the small UART FIFO while
+* a command is busy. Commands run back to back with their output batched
+* (uart_batch_begin), and the total time is reported at the end.
+*
+* Building with SCRIPT_FLAGS='-DBOOT_SCRIPT=\"selftest\"' runs a script
+* before the first prompt, for unattended QEMU runs.
+*/
+#define SCRIPT_BUF_SIZE 4096      //pasted script
+#define SCRIPT_OUT_SIZE 2048      //output batch
+#define SCRIPT_PASTE_IDLE_MS 1000 //a paste ends after this long without input
+
+typedef struct {
+    const char *name;
+    const char *text;
+} script;
+
+/* Function prototypes */
+int script_run(const char *text);
+int script_run_named(const char *name);
+void script_command(const char *arg);
+
+#endif
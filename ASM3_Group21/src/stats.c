@@ -0,0 +1,138 @@
+// -----------------------------------stats.c -------------------------------------
+#include "stats.h"
+#include "clock.h"
+#include "sched.h"
+#include "printf.h"
+#include "string.h"
+#include "../uart/uart.h"
+
+typedef struct {
+    const char *name;
+    int gauge;
+} stats_field;
+
+/* One subsystem: its counter struct seen as an array of unsigned long */
+typedef struct {
+    const char *name;
+    unsigned long *counters;
+    const stats_field *fields;
+    int count;
+} stats_group;
+
+static const stats_field fb_fields[] = { { .name = "pixels" }, { .name = "blits" } };
+static const stats_field uart_fields[] = { { .name = "tx_bytes" }, { .name = "rx_bytes" } };
+static const stats_field mbox_fields[] = { { .name = "calls" }, { .name = "wait_cycles" } };
+static const stats_field heap_fields[] = { { .name = "allocated" }, { .name = "live", .gauge = 1 }, { .name = "failed" } };
+static const stats_field game_fields[] = { { .name = "frames" } };
+
+#define GROUP(name, var, fields) \
+    { name, (unsigned long *)&var, fields, sizeof(fields) / sizeof(fields[0]) }
+
+static const stats_group groups[] = {
+    GROUP("fb", fb_stats, fb_fields),
+    GROUP("uart", uart_stats, uart_fields),
+    GROUP("mbox", mbox_stats, mbox_fields),
+    GROUP("heap", heap_stats, heap_fields),
+    GROUP("maze_heap", maze_heap_stats, heap_fields),
+    GROUP("game", game_stats, game_fields),
+};
+
+#define GROUPS (int)(sizeof(groups) / sizeof(groups[0]))
+
+/* Copy every counter into snap, in table order; returns how many */
+static int stats_snapshot(unsigned long *snap)
+{
+    int n = 0;
+    for (int g = 0; g < GROUPS; g++)
+        for (int i = 0; i < groups[g].count && n < STATS_MAX_FIELDS; i++)
+            snap[n++] = groups[g].counters[i];
+    return n;
+}
+
+/**
+* Print every counter
+*/
+void stats_print()
+{
+    for (int g = 0; g < GROUPS; g++)
+        for (int i = 0; i < groups[g].count; i++)
+            printf("%-9s %-12s %14lu%s\n", i == 0 ? groups[g].name : "", groups[g].fields[i].name,
+                   groups[g].counters[i], groups[g].fields[i].gauge ? " (now)" : "");
+}
+
+/**
+* Zero the counters (gauges keep their value)
+*/
+void stats_reset()
+{
+    for (int g = 0; g < GROUPS; g++)
+        for (int i = 0; i < groups[g].count; i++)
+            if (!groups[g].fields[i].gauge)
+                groups[g].counters[i] = 0;
+}
+
+/**
+* Every interval_ms, print how fast the counters moved (per second) until
+* a key is pressed. Counters that did not change are left out; gauges
+* show their value. The shell task sleeps in between, so the game and the
+* video keep running.
+*/
+void stats_rate(unsigned int interval_ms)
+{
+    unsigned long prev[STATS_MAX_FIELDS], cur[STATS_MAX_FIELDS];
+
+    if (interval_ms < STATS_RATE_MIN_MS)
+        interval_ms = STATS_RATE_MIN_MS;
+    printf("Sampling every %u ms, press any key to stop\n", interval_ms);
+
+    stats_snapshot(prev);
+    unsigned long last = now_cycles();
+    while (!uart_rx_ready()) {
+        task_sleep_ms(interval_ms);
+        int n = stats_snapshot(cur);
+        unsigned long now = now_cycles();
+        unsigned long us = cycles_to_ns(now - last) / 1000;
+        last = now;
+
+        printf("%5lu.%03lu ms", us / 1000, us % 1000);
+        int k = 0;
+        for (int g = 0; g < GROUPS; g++) {
+            for (int i = 0; i < groups[g].count && k < n; i++, k++) {
+                if (groups[g].fields[i].gauge)
+                    printf("  %s.%s %lu", groups[g].name, groups[g].fields[i].name, cur[k]);
+                else if (cur[k] != prev[k] && us > 0)
+                    printf("  %s.%s %lu/s", groups[g].name, groups[g].fields[i].name,
+                           (cur[k] - prev[k]) * 1000000 / us);
+                prev[k] = cur[k];
+            }
+        }
+        printf("\n");
+    }
+    uart_getc();
+}
+
+/**
+* stats: print the counters
+* stats reset: zero them
+* stats rate [ms]: sample them every ms milliseconds (1000 by default)
+*/
+void stats_command(int argc, char **argv)
+{
+    if (argc == 1) {
+        stats_print();
+    } else if (strcmp(argv[1], "reset") == 0 && argc == 2) {
+        stats_reset();
+    } else if (strcmp(argv[1], "rate") == 0) {
+        unsigned int ms = 0;
+        const char *p = argc > 2 ? argv[2] : "1000";
+        for (; *p >= '0' && *p <= '9'; p++)
+            ms = ms * 10 + (*p - '0');
+        if (*p) {
+            printf("stats: bad interval %s\n", argv[2]);
+            return;
+        }
+        stats_rate(ms);
+    } else {
+        printf("Usage: stats [reset|rate [ms]]\n");
+    }
+}
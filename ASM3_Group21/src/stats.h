@@ -0,0 +1,66 @@
+// -----------------------------------stats.h -------------------------------------
+#ifndef STATS_H
+#define STATS_H
+
+/*
+* Runtime counters. Each subsystem owns one struct of unsigned long
+* counters below, defined in its own source file, and bumps them with
+* STAT_INC/STAT_ADD: a single add to a global, with no locking. A counter
+* also written from IRQ context (the mailbox ones: perf submits from the
+* mailbox IRQ) is bumped inside the irq_save()/irq_restore() section of
+* its caller, so no count is lost. Build with make STATS_FLAGS=-DSTATS=0
+* to compile them out.
+*
+* Gauges (e.g. live heap bytes) hold a current value rather than a total:
+* `stats reset` keeps them and `stats rate` shows them as they are.
+*/
+#ifndef STATS
+#define STATS 1
+#endif
+
+#define STAT_ADD(counter, n) do { if (STATS) (counter) += (n); } while (0)
+#define STAT_INC(counter) STAT_ADD(counter, 1)
+#define STAT_SET(gauge, v) do { if (STATS) (gauge) = (v); } while (0)
+
+#define STATS_MAX_FIELDS 16 //counters over all subsystems
+#define STATS_RATE_MIN_MS 10
+
+typedef struct {
+    unsigned long pixels;       // drawPixelARGB32 calls
+    unsigned long blits;        // glyphs, tiles, images and video frames drawn
+} fb_counters;
+
+typedef struct {
+    unsigned long tx_bytes;     // sent, through the FIFO or by DMA
+    unsigned long rx_bytes;
+} uart_counters;
+
+typedef struct {
+    unsigned long calls;        // messages sent (mbox_call and mbox_submit)
+    unsigned long wait_cycles;  // counter ticks spent waiting for responses
+} mbox_counters;
+
+typedef struct {
+    unsigned long allocated;    // bytes handed out
+    unsigned long live;         // bytes in use (gauge)
+    unsigned long failed;       // allocations that did not fit
+} heap_counters;
+
+typedef struct {
+    unsigned long frames;       // frames rendered by the game task
+} game_counters;
+
+extern fb_counters fb_stats;            // framebf.c
+extern uart_counters uart_stats;        // uart.c
+extern mbox_counters mbox_stats;        // mbox.c
+extern heap_counters heap_stats;        // malloc() in main.c
+extern heap_counters maze_heap_stats;   // selfmalloc() in Maze.c
+extern game_counters game_stats;        // main.c
+
+/* Function prototypes */
+void stats_print();
+void stats_reset();
+void stats_rate(unsigned int interval_ms);
+void stats_command(int argc, char **argv);
+
+#endif
@@ -0,0 +1,19 @@
+// -----------------------------------string.h -------------------------------------
+#ifndef STRING_H
+#define STRING_H
+
+#include "../gcclib/stddef.h"
+
+/*
+* The C string functions, defined in main.c (there is no libc).
+*/
+
+/* Function prototypes */
+size_t strlen(const char *str);
+int strcmp(const char *str1, const char *str2);
+int strncmp(const char *str1, const char *str2, size_t n);
+char *strcpy(char *dest, const char *src);
+char *strncpy(char *dest, const char *src, size_t n);
+char *strcat(char *dest, const char *src);
+
+#endif
@@ -1,41 +1,249 @@
 #include "timer.h"
+#include "irq.h"
+#include "clock.h"
 
-/* Function to wait for some msec: the program will stop there */
+/* Function to wait for n microseconds (despite the name): the program will stop there */
 void wait_msec(unsigned int n)
 {
-    register unsigned long f, t, r, expiredTime;
-
-    // Get the current counter frequency (Hz)
-    asm volatile ("mrs %0, cntfrq_el0" : "=r"(f));
-    
-    // Read the current counter value
-    asm volatile ("mrs %0, cntpct_el0" : "=r"(t));
-    
-    // Calculate expire value for counter
-    expiredTime = t + ( (f/1000)*n )/1000;
-    do {
-    	asm volatile ("mrs %0, cntpct_el0" : "=r"(r));
-    } while(r < expiredTime);
+    unsigned long expiredTime = now_cycles() + us_to_cycles(n);
+    while (now_cycles() < expiredTime)
+        ;
 }
 
-/* Function to start a timer (set = 1) or wait for it to expire (set = 0) */
+/* Function to start a timer of msVal microseconds (set = 1) or wait for it to expire (set = 0) */
 void set_wait_timer(int set, unsigned int msVal) {
     static unsigned long expiredTime = 0; //declare static to keep value
-    register unsigned long r, f, t;
-    
+
     if (set) { /* SET TIMER */
-        // Get the current counter frequency (Hz)
-        asm volatile ("mrs %0, cntfrq_el0" : "=r"(f));
+        expiredTime = now_cycles() + us_to_cycles(msVal);
+    }
+    else { /* WAIT FOR TIMER TO EXPIRE */
+        while (now_cycles() < expiredTime)
+            ;
+    }
+}
 
-        // Read the current counter
-        asm volatile ("mrs %0, cntpct_el0" : "=r"(t));
 
-        // Calculate expired time:
-        expiredTime = t + ( (f/1000)*msVal )/1000;
-    } 
-    else { /* WAIT FOR TIMER TO EXPIRE */
-        do {
-            asm volatile ("mrs %0, cntpct_el0" : "=r"(r));
-        } while(r < expiredTime);
+/* ----------------------------------- timer wheel ------------------------------------- */
+
+static timer *wheel[TIMER_LEVELS][TIMER_SLOTS];
+static unsigned long wheel_used[TIMER_LEVELS]; // bit per non-empty slot
+static unsigned long wheel_clk;  // next millisecond to process
+static unsigned int wheel_count; // pending timers
+static unsigned long ticks_per_ms;
+static int timer_running = 0;
+
+/* Milliseconds since boot */
+unsigned long timer_ms()
+{
+    return now_cycles() / ticks_per_ms;
+}
+
+static void wheel_insert(timer *t)
+{
+    long delta = (long)(t->expires - wheel_clk);
+    unsigned long expires = t->expires;
+    int level = 0;
+
+    if (delta < 0) {
+        expires = wheel_clk; // overdue: run with the next millisecond
+    } else {
+        // lowest level whose range covers delta, the top level wraps around
+        while (level < TIMER_LEVELS - 1 && delta >= 1L << (TIMER_SLOT_BITS * (level + 1)))
+            level++;
+    }
+    unsigned int slot = (expires >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1);
+
+    t->next = wheel[level][slot];
+    if (t->next)
+        t->next->pprev = &t->next;
+    t->pprev = &wheel[level][slot];
+    wheel[level][slot] = t;
+    wheel_used[level] |= 1UL << slot;
+}
+
+static void wheel_remove(timer *t)
+{
+    *t->pprev = t->next;
+    if (t->next)
+        t->next->pprev = t->pprev;
+    t->pprev = 0;
+}
+
+/* Clear the used bit of an emptied slot. Slots emptied by timer_cancel()
+   keep theirs until they come up, which only costs a spurious interrupt */
+static void wheel_tidy(int level, unsigned int slot)
+{
+    if (wheel[level][slot] == 0)
+        wheel_used[level] &= ~(1UL << slot);
+}
+
+/* Move the timers of a higher level slot down the wheel */
+static void wheel_cascade(int level, unsigned int slot)
+{
+    timer *t = wheel[level][slot];
+    wheel[level][slot] = 0;
+    wheel_used[level] &= ~(1UL << slot);
+    while (t) {
+        timer *next = t->next;
+        wheel_insert(t);
+        t = next;
+    }
+}
+
+/* First millisecond >= wheel_clk at which a slot has to be run or cascaded */
+static unsigned long wheel_next_event()
+{
+    unsigned long best = ~0UL;
+
+    for (int level = 0; level < TIMER_LEVELS; level++) {
+        if (!wheel_used[level])
+            continue;
+        int shift = TIMER_SLOT_BITS * level;
+        // first slot boundary of this level not processed yet
+        unsigned long start = (wheel_clk + (1UL << shift) - 1) >> shift;
+        unsigned int rot = start & (TIMER_SLOTS - 1);
+        unsigned long used = wheel_used[level];
+        used = rot ? (used >> rot) | (used << (TIMER_SLOTS - rot)) : used;
+        unsigned long when = (start + __builtin_ctzl(used)) << shift;
+        if (when < best)
+            best = when;
+    }
+    return best;
+}
+
+/* Run everything due up to and including millisecond now */
+static void wheel_run(unsigned long now)
+{
+    while (wheel_clk <= now) {
+        if (wheel_count == 0) {
+            wheel_clk = now + 1;
+            break;
+        }
+        unsigned long next = wheel_next_event();
+        if (next > now) {
+            wheel_clk = now + 1;
+            break;
+        }
+        wheel_clk = next;
+
+        // cascade the levels whose lower level just wrapped around
+        unsigned int slot = wheel_clk & (TIMER_SLOTS - 1);
+        for (int level = 1; level < TIMER_LEVELS && slot == 0; level++) {
+            slot = (wheel_clk >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1);
+            wheel_cascade(level, slot);
+        }
+
+        slot = wheel_clk & (TIMER_SLOTS - 1);
+        while (wheel[0][slot]) {
+            timer *t = wheel[0][slot];
+            wheel_remove(t);
+            if (t->period) {
+                t->expires += t->period;
+                wheel_insert(t);
+            } else {
+                wheel_count--;
+            }
+            t->fn(t->ctx);
+        }
+        wheel_tidy(0, slot);
+        wheel_clk++;
     }
-}
\ No newline at end of file
+}
+
+/* Program the compare value for the next event, or stop the timer */
+static void timer_program()
+{
+    if (wheel_count == 0) {
+        asm volatile ("msr cntp_ctl_el0, %0" :: "r"(0UL));
+        return;
+    }
+    unsigned long cval = wheel_next_event() * ticks_per_ms;
+    asm volatile ("msr cntp_cval_el0, %0" :: "r"(cval));
+    asm volatile ("msr cntp_ctl_el0, %0" :: "r"(1UL)); // enabled, not masked
+}
+
+static void timer_irq(void *ctx)
+{
+    wheel_run(timer_ms());
+    timer_program();
+}
+
+/* Function to start the timer service (after clock_init and irq_init) */
+void timer_init()
+{
+    ticks_per_ms = clock_freq / 1000;
+    wheel_clk = timer_ms();
+
+    irq_register(IRQ_CNTPNS, timer_irq, 0);
+    irq_unmask(IRQ_CNTPNS);
+    timer_running = 1;
+}
+
+/* Function to call fn(ctx) in ms milliseconds (at least), then every period_ms if non-zero */
+void timer_add(timer *t, unsigned int ms, unsigned int period_ms, timer_fn fn, void *ctx)
+{
+    unsigned long flags = irq_save();
+    if (t->pprev) {
+        wheel_remove(t);
+        wheel_count--;
+    }
+    if (wheel_count == 0)
+        wheel_clk = timer_ms(); // nothing pending: the wheel may be idle since long
+    // +1: the current millisecond has partly passed already
+    t->expires = timer_ms() + ms + 1;
+    t->period = period_ms;
+    t->fn = fn;
+    t->ctx = ctx;
+    wheel_insert(t);
+    wheel_count++;
+    timer_program();
+    irq_restore(flags);
+}
+
+/* Function to stop a pending timer (no effect when it is not pending) */
+void timer_cancel(timer *t)
+{
+    unsigned long flags = irq_save();
+    if (t->pprev) {
+        wheel_remove(t);
+        wheel_count--;
+        timer_program();
+    }
+    irq_restore(flags);
+}
+
+int timer_pending(timer *t)
+{
+    return t->pprev != 0;
+}
+
+/* Function to sleep (wfi) until an interrupt handler sets *flag */
+void sleep_until(volatile int *flag)
+{
+    while (!*flag) {
+        unsigned long flags = irq_save();
+        if (!*flag)
+            asm volatile ("wfi"); // wakes up on the pending IRQ even while masked
+        irq_restore(flags);
+    }
+}
+
+static void sleep_done(void *flag)
+{
+    *(volatile int *)flag = 1;
+}
+
+/* Function to sleep for ms milliseconds, with the core parked in wfi */
+void sleep_ms(unsigned int ms)
+{
+    volatile int done = 0;
+    timer t = { 0 };
+
+    if (!timer_running || !irq_enabled()) {
+        wait_msec(ms * 1000);
+        return;
+    }
+    timer_add(&t, ms, 0, sleep_done, (void *)&done);
+    sleep_until(&done);
+}
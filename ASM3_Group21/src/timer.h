@@ -1,2 +1,42 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+/*
+* Timer service on the EL1 physical timer (CNTP) interrupt
+*
+* Pending timers sit in a hierarchical timer wheel: TIMER_LEVELS levels of
+* TIMER_SLOTS slots, level n slots spanning TIMER_SLOTS^n milliseconds, so
+* adding and cancelling are O(1) and a timer is moved down a level at most
+* TIMER_LEVELS - 1 times. There is no periodic tick: the compare register
+* is programmed for the next slot that holds a timer (or must be moved
+* down), and the timer interrupt is off while nothing is pending.
+* Callbacks run in IRQ context.
+*/
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS (1 << TIMER_SLOT_BITS)
+#define TIMER_LEVELS 4
+
+typedef void (*timer_fn)(void *ctx);
+
+/* A pending callback (storage owned by the caller until it fired or was cancelled) */
+typedef struct timer {
+    struct timer *next;
+    struct timer **pprev;      // link pointing at this timer, NULL when not pending
+    unsigned long expires;     // milliseconds (timer_ms() clock)
+    unsigned int period;       // re-arm interval in ms, 0 for one-shot
+    timer_fn fn;
+    void *ctx;
+} timer;
+
+/* Function prototypes */
 void wait_msec(unsigned int n);
-void set_wait_timer(int set, unsigned int msVal);
\ No newline at end of file
+void set_wait_timer(int set, unsigned int msVal);
+void timer_init();
+unsigned long timer_ms();
+void timer_add(timer *t, unsigned int ms, unsigned int period_ms, timer_fn fn, void *ctx);
+void timer_cancel(timer *t);
+int timer_pending(timer *t);
+void sleep_until(volatile int *flag);
+void sleep_ms(unsigned int ms);
+
+#endif
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Decode binary LOG() records sent by the kernel's `log` command.
+
+Usage: logdecode.py kernel8.elf capture.bin [--freq HZ]
+
+capture.bin is the raw serial output (e.g. from
+`qemu-system-aarch64 ... -serial null -serial stdio > capture.bin`).
+Format strings are looked up by id in the .logfmt section of kernel8.elf;
+%s arguments are read from the loaded sections of the same file.
+"""
+import re
+import struct
+import sys
+
+MAGIC = b"BLOG"
+CONVERSION = re.compile(r"%([-+ 0#]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|z)?([diuxXpcsf%])")
+
+
+class Elf:
+    """Minimal ELF64 little-endian reader: section lookup and address reads."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 2:
+            raise ValueError("%s is not an ELF64 file" % path)
+        shoff, = struct.unpack_from("<Q", self.data, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", self.data, 0x3A)
+        headers = []
+        for i in range(shnum):
+            (name, stype, flags, addr, offset, size) = struct.unpack_from(
+                "<IIQQQQ", self.data, shoff + i * shentsize)
+            headers.append((name, stype, flags, addr, offset, size))
+        strtab = headers[shstrndx]
+        self.sections = {}
+        for name, stype, flags, addr, offset, size in headers:
+            end = self.data.index(b"\0", strtab[4] + name)
+            sname = self.data[strtab[4] + name:end].decode()
+            self.sections[sname] = (stype, flags, addr, offset, size)
+
+    def cstring_in(self, section, addr):
+        stype, flags, base, offset, size = self.sections[section]
+        if not base <= addr < base + size or stype == 8:  # SHT_NOBITS
+            return None
+        start = offset + addr - base
+        return self.data[start:self.data.index(b"\0", start)].decode(errors="replace")
+
+    def format_string(self, fmt_id):
+        return self.cstring_in(".logfmt", fmt_id)
+
+    def string_at(self, addr):
+        for name, (stype, flags, base, offset, size) in self.sections.items():
+            if flags & 2 and base <= addr < base + size:  # SHF_ALLOC
+                return self.cstring_in(name, addr)
+        return None
+
+
+def read_varint(buf, pos):
+    value = shift = 0
+    while True:
+        b = buf[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if b < 0x80:
+            return value, pos
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def render(elf, fmt, args):
+    """Apply a C format string to 64-bit argument values."""
+    args = list(args)
+
+    def take():
+        return args.pop(0) if args else 0
+
+    def convert(m):
+        flags, width, precision, length, conv = m.groups()
+        if conv == "%":
+            return "%"
+        if width == "*":
+            width = str(take())
+        if precision == "*":
+            precision = str(take())
+        spec = "%" + flags + (width or "") + ("." + precision if precision is not None else "")
+        v = take()
+        wide = length in ("l", "ll", "z")
+        if conv in "di":
+            if wide:
+                v -= (v & (1 << 63)) << 1
+            else:
+                v = (v & 0xFFFFFFFF) - ((v & 0x80000000) << 1)
+            return (spec + "d") % v
+        if conv in "uxX":
+            return (spec + conv.replace("u", "d")) % (v & (0xFFFFFFFFFFFFFFFF if wide else 0xFFFFFFFF))
+        if conv == "p":
+            return (spec + "s") % ("0x%x" % (v & 0xFFFFFFFFFFFFFFFF))
+        if conv == "c":
+            return (spec + "c") % chr(v & 0xFF)
+        if conv == "s":
+            s = elf.string_at(v & 0xFFFFFFFFFFFFFFFF)
+            return (spec + "s") % (s if s is not None else "<%#x>" % v)
+        return (spec + "s") % "<%f unsupported>"
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode(elf, capture, freq=None):
+    pos = 0
+    while True:
+        pos = capture.find(MAGIC, pos)
+        if pos < 0 or pos + 16 > len(capture):
+            return
+        block_freq, dropped, length = struct.unpack_from("<III", capture, pos + 4)
+        payload = capture[pos + 16:pos + 16 + length]
+        pos += 16 + length
+        if len(payload) < length:
+            print("warning: truncated log block", file=sys.stderr)
+            return
+        hz = freq or block_freq or 1
+        if dropped:
+            print("warning: %d records dropped (ring buffer full)" % dropped, file=sys.stderr)
+        p = 0
+        ts = 0
+        first = True
+        while p < len(payload):
+            fmt_id, p = read_varint(payload, p)
+            delta, p = read_varint(payload, p)
+            ts = delta if first else ts + delta
+            first = False
+            nargs = payload[p]
+            p += 1
+            args = []
+            for _ in range(nargs):
+                v, p = read_varint(payload, p)
+                args.append(unzigzag(v) & 0xFFFFFFFFFFFFFFFF)
+            fmt = elf.format_string(fmt_id)
+            text = render(elf, fmt, args) if fmt is not None else "<unknown id %#x> %r" % (fmt_id, args)
+            yield ts / hz, text
+
+
+def main(argv):
+    if len(argv) < 3:
+        print(__doc__, file=sys.stderr)
+        return 2
+    freq = None
+    if "--freq" in argv:
+        freq = int(argv[argv.index("--freq") + 1])
+    elf = Elf(argv[1])
+    if ".logfmt" not in elf.sections:
+        print("%s has no .logfmt section" % argv[1], file=sys.stderr)
+        return 1
+    with open(argv[2], "rb") as f:
+        capture = f.read()
+    for seconds, text in decode(elf, capture, freq):
+        print("[%12.6f] %s" % (seconds, text))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
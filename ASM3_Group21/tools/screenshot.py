@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Rebuild PNG images from the kernel's `screenshot` command output.
+
+Usage: screenshot.py capture.bin [output-prefix]
+
+capture.bin is the raw serial output (e.g. from
+`qemu-system-aarch64 ... -serial null -serial stdio > capture.bin`).
+Every screenshot found in the capture becomes <prefix>_<sequence>.png
+(prefix defaults to "screenshot"). Incremental shots are applied on top of
+the previous image, so a full shot followed by `screenshot diff` shots
+records a frame sequence.
+"""
+import struct
+import sys
+import zlib
+
+MAGIC = b"SHOT"
+HEADER = struct.Struct("<4sHHBBHI")
+FLAG_INCREMENTAL = 0x01
+
+
+def qoi_decode(data, count):
+    """Decode `count` pixels of per-tile QOI chunks into a list of (r, g, b)."""
+    index = [(0, 0, 0)] * 64
+    r = g = b = 0
+    pixels = []
+    pos = 0
+    while len(pixels) < count:
+        op = data[pos]
+        pos += 1
+        if op == 0xFE:
+            r, g, b = data[pos], data[pos + 1], data[pos + 2]
+            pos += 3
+        elif op >> 6 == 0:
+            r, g, b = index[op]
+        elif op >> 6 == 1:
+            r = (r + ((op >> 4) & 3) - 2) & 0xFF
+            g = (g + ((op >> 2) & 3) - 2) & 0xFF
+            b = (b + (op & 3) - 2) & 0xFF
+        elif op >> 6 == 2:
+            vg = (op & 0x3F) - 32
+            second = data[pos]
+            pos += 1
+            r = (r + vg + (second >> 4) - 8) & 0xFF
+            g = (g + vg) & 0xFF
+            b = (b + vg + (second & 0x0F) - 8) & 0xFF
+        else:
+            pixels.extend([(r, g, b)] * ((op & 0x3F) + 1))
+            continue
+        index[(r * 3 + g * 5 + b * 7 + 255 * 11) % 64] = (r, g, b)
+        pixels.append((r, g, b))
+    return pixels[:count]
+
+
+def write_png(path, width, height, canvas):
+    def chunk(tag, body):
+        return (struct.pack(">I", len(body)) + tag + body
+                + struct.pack(">I", zlib.crc32(tag + body)))
+
+    raw = bytearray()
+    for y in range(height):
+        raw.append(0)  # filter: none
+        raw += canvas[y * width * 3:(y + 1) * width * 3]
+    with open(path, "wb") as f:
+        f.write(b"\x89PNG\r\n\x1a\n")
+        f.write(chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 2, 0, 0, 0)))
+        f.write(chunk(b"IDAT", zlib.compress(bytes(raw), 9)))
+        f.write(chunk(b"IEND", b""))
+
+
+def decode(capture):
+    """Yield (sequence, width, height, canvas) for every valid screenshot."""
+    canvas = None
+    pos = 0
+    while True:
+        pos = capture.find(MAGIC, pos)
+        if pos < 0 or pos + HEADER.size > len(capture):
+            return
+        start = pos
+        _, width, height, tile, flags, count, seq = HEADER.unpack_from(capture, pos)
+        pos += HEADER.size
+        tiles_x = (width + tile - 1) // tile
+        # tiles go into a copy: a shot that fails its CRC must not leave them behind
+        if canvas is None or len(canvas) != width * height * 3 or not flags & FLAG_INCREMENTAL:
+            if flags & FLAG_INCREMENTAL and (canvas is None or len(canvas) != width * height * 3):
+                print("shot %d: incremental without a base image" % seq, file=sys.stderr)
+            shot = bytearray(width * height * 3)
+        else:
+            shot = bytearray(canvas)
+        try:
+            for _ in range(count):
+                t, length = struct.unpack_from("<HH", capture, pos)
+                pos += 4
+                x0, y0 = (t % tiles_x) * tile, (t // tiles_x) * tile
+                tw, th = min(tile, width - x0), min(tile, height - y0)
+                pixels = qoi_decode(capture[pos:pos + length], tw * th)
+                pos += length
+                for y in range(th):
+                    row = bytes(c for px in pixels[y * tw:(y + 1) * tw] for c in px)
+                    offset = ((y0 + y) * width + x0) * 3
+                    shot[offset:offset + tw * 3] = row
+            crc, = struct.unpack_from("<I", capture, pos)
+        except (IndexError, struct.error):
+            print("shot %d: truncated" % seq, file=sys.stderr)
+            return
+        if zlib.crc32(capture[start:pos]) != crc:
+            print("shot %d: CRC mismatch, skipped" % seq, file=sys.stderr)
+            pos = start + 1
+            continue
+        pos += 4
+        canvas = shot
+        yield seq, width, height, canvas
+
+
+def main(argv):
+    if len(argv) < 2:
+        print(__doc__, file=sys.stderr)
+        return 2
+    prefix = argv[2] if len(argv) > 2 else "screenshot"
+    with open(argv[1], "rb") as f:
+        capture = f.read()
+    shots = 0
+    for seq, width, height, canvas in decode(capture):
+        path = "%s_%04d.png" % (prefix, seq)
+        write_png(path, width, height, canvas)
+        print(path)
+        shots += 1
+    if shots == 0:
+        print("no screenshot found in %s" % argv[1], file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -1,42 +1,42 @@
 #include "uart.h"
 #include "../src/mbox.h"
+#include "../src/dma.h"
+#include "../src/numfmt.h"
+#include "../src/stats.h"
+
+/* Currently selected console port and its baud rate */
+static int console_port = UART_CONSOLE;
+static unsigned int console_baud = UART_BAUD;
+static int console_ready = 0;       //a port has been set up (uart_init done)
+
+/* DMA transmit state. The DMA engine only moves 32-bit words and the PL011
+   data register takes the low byte of each write, so staging buffers hold
+   one character per word. While one buffer is on the wire the CPU fills
+   the other. */
+static dma_cb dma_tx_cb;
+static unsigned int __attribute__((aligned(16))) dma_tx_buf[2][UART_DMA_BUF_WORDS];
+static int dma_tx_ready = 0;         //PL011 is the console and its DMA channel is set up
+static int dma_tx_next = 0;          //staging buffer the CPU fills next
+static volatile int dma_tx_active = 0;
+static unsigned int dma_tx_completed = 0;
+
+uart_counters uart_stats;
+
+/* Output batching (uart_batch_begin): writes collect in batch_buf and go
+   out in large blocks, by DMA when the console has it */
+static char *batch_buf = 0;
+static unsigned int batch_size, batch_len;
 
 /**
- * Set baud rate and characteristics (115200 8N1) and map to GPIO
+ * Route GPIO 14, 15 to the given alternate function (no pull up/down)
  */
-void uart_init()
+static void uart_gpio_setup(unsigned int alt)
 {
     unsigned int r;
 
-    /* initialize UART */
-    AUX_ENABLE |= 1;     //enable mini UART (UART1) 
-    AUX_MU_CNTL = 0;	 //stop transmitter and receiver
-    AUX_MU_LCR  = 3;     //8-bit mode (also enable bit 1 to be used for RPI3)
-    AUX_MU_MCR  = 0;	 //clear RTS (request to send)
-    AUX_MU_IER  = 0;	 //disable interrupts
-    AUX_MU_IIR  = 0xc6;  //enable and clear FIFOs
-    AUX_MU_BAUD = 270;   //configure 115200 baud rate [system_clk_freq/(baud_rate*8) - 1]
-
-    /* Note: refer to page 11 of ARM Peripherals guide for baudrate configuration 
-    (system_clk_freq is 250MHz by default) */
-	
-	/* NEW: set up UART clock for consistent divisor values 
-	--> may not work with QEMU, but will work with real board */ 
-	mBuf[0] = 9*4; 
-	mBuf[1] = MBOX_REQUEST; 
-	mBuf[2] = MBOX_TAG_SETCLKRATE; // set clock rate 
-	mBuf[3] = 12; // Value buffer size in bytes
-	mBuf[4] = 0; // REQUEST CODE = 0
-	mBuf[5] = 2; // clock id: UART clock
-	mBuf[6] = 4000000;     // rate: 4Mhz 
-	mBuf[7] = 0;           // clear turbo 
-	mBuf[8] = MBOX_TAG_LAST; 
-	mbox_call(ADDR(mBuf), MBOX_CH_PROP);
-
-    /* map UART1 to GPIO pins 14 and 15 */
     r = GPFSEL1;
     r &=  ~( (7 << 12)|(7 << 15) ); //clear bits 17-12 (FSEL15, FSEL14)
-    r |= (0b010 << 12)|(0b010 << 15);   //set value 0b010 (select ALT5: TXD1/RXD1)
+    r |= (alt << 12)|(alt << 15);   //select ALT0 (TXD0/RXD0) or ALT5 (TXD1/RXD1)
     GPFSEL1 = r;
 
 	/* enable GPIO 14, 15 */
@@ -53,14 +53,220 @@ void uart_init()
 	r &= ~((3 << 28) | (3 << 30)); //No resistor is selected for GPIO 14, 15
 	GPIO_PUP_PDN_CNTRL_REG0 = r;
 #endif
+}
+
+/**
+ * Set up the mini UART (UART1) with the given baud rate, 8N1
+ */
+static void mini_uart_init(unsigned int baud)
+{
+    /* initialize UART */
+    AUX_ENABLE |= 1;     //enable mini UART (UART1) 
+    AUX_MU_CNTL = 0;	 //stop transmitter and receiver
+    AUX_MU_LCR  = 3;     //8-bit mode (also enable bit 1 to be used for RPI3)
+    AUX_MU_MCR  = 0;	 //clear RTS (request to send)
+    AUX_MU_IER  = 0;	 //disable interrupts
+    AUX_MU_IIR  = 0xc6;  //enable and clear FIFOs
+
+    /* Note: refer to page 11 of ARM Peripherals guide for baudrate configuration 
+    [system_clk_freq/(baud_rate*8) - 1], rounded to nearest (270 for 115200) */
+    AUX_MU_BAUD = (SYSTEM_CLOCK + 4 * baud) / (8 * baud) - 1;
+
+    /* map UART1 to GPIO pins 14 and 15 */
+    uart_gpio_setup(0b010);
 
     AUX_MU_CNTL = 3;      //enable transmitter and receiver (Tx, Rx)
+    dma_tx_ready = 0;     //no DREQ for the mini UART
+    console_ready = 1;
+}
+
+/**
+ * Set up the PL011 UART (UART0) with the given baud rate, 8N1, FIFOs on
+ */
+static void pl011_init(unsigned int baud)
+{
+	/* set up UART clock for consistent divisor values 
+	--> may not work with QEMU, but will work with real board. */
+	mbox_msg m;
+	mbox_msg_init(&m, mBuf, MBOX_BUF_WORDS);
+	mbox_set_clock_rate(&m, MBOX_CLK_UART, UART0_CLOCK, 0); // rate: 48Mhz
+	mbox_msg_send(&m);
+
+    UART0_CR = 0;        //disable UART0 while it is reconfigured
+
+    /* map UART0 to GPIO pins 14 and 15 */
+    uart_gpio_setup(0b100);
+
+    /* Divisor = UART0_CLOCK / (16 * baud), kept in 16.6 fixed point:
+       UART0_CLOCK * 4 / baud, rounded to nearest */
+    unsigned int div = (UART0_CLOCK * 4 + baud / 2) / baud;
+
+    UART0_ICR  = 0x7FF;          //clear pending interrupts
+    UART0_IBRD = div >> 6;       //integer part
+    UART0_FBRD = div & 0x3F;     //fractional part (1/64ths)
+    UART0_LCRH = (3 << 5) | (1 << 4); //8-bit words, FIFOs enabled
+    UART0_IMSC = 0;              //mask all interrupts
+    UART0_IFLS = 0;              //TX DREQ when the FIFO drops to 1/8 full
+    UART0_DMACR = (1 << 1);      //TXDMAE: let the DMA engine feed the FIFO
+    UART0_CR   = 0x301;          //enable UART, transmitter and receiver
+
+    dma_init(DMA_CH_UART);
+    dma_tx_ready = 1;
+    console_ready = 1;
+}
+
+/**
+ * Set up the console UART selected at compile time (UART_CONSOLE, UART_BAUD)
+ */
+void uart_init()
+{
+    uart_config(UART_CONSOLE, UART_BAUD);
+}
+
+/**
+ * Switch the console to the given port (UART_PL011 or UART_MINI) and baud rate.
+ * Pending output on the old port is drained first (none at the first call,
+ * from uart_init, where no port is set up yet and the mini UART's status
+ * register cannot be polled). Returns 0 for unsupported settings.
+ */
+int uart_config(int port, unsigned int baud)
+{
+    if ((port != UART_PL011 && port != UART_MINI) || baud == 0)
+        return 0;
+    // PL011 needs 16 reference clocks per bit, the mini UART 8 system clocks
+    if (port == UART_PL011 && baud > UART0_CLOCK / 16)
+        return 0;
+    if (port == UART_MINI && baud > SYSTEM_CLOCK / 8)
+        return 0;
+
+    if (console_ready) {
+        uart_dma_wait();
+        uart_flush();
+    }
+    if (port == UART_PL011)
+        pl011_init(baud);
+    else
+        mini_uart_init(baud);
+
+    console_port = port;
+    console_baud = baud;
+    return 1;
+}
+
+/**
+ * Currently selected console port
+ */
+int uart_port()
+{
+    return console_port;
+}
+
+/**
+ * Currently configured console baud rate
+ */
+unsigned int uart_baud()
+{
+    return console_baud;
+}
+
+/**
+ * Wait until everything written so far has left the transmitter
+ */
+void uart_flush()
+{
+    uart_batch_flush();
+    uart_dma_wait();
+    if (console_port == UART_PL011) {
+        while (UART0_FR & UART0_FR_BUSY)
+            asm volatile("nop");
+    } else {
+        // bit 6: transmitter idle (FIFO empty and shift register done)
+        while (!(AUX_MU_LSR & 0x40))
+            asm volatile("nop");
+    }
+}
+
+/**
+ * Send a raw block of bytes, topping up the transmit FIFO in bursts
+ * instead of polling the status register before every byte
+ */
+static void uart_write_fifo(const char *buf, unsigned int len)
+{
+    STAT_ADD(uart_stats.tx_bytes, len);
+    if (console_port == UART_PL011) {
+        if (dma_tx_active)
+            uart_dma_wait(); //keep ordering with queued DMA output
+        while (len) {
+            unsigned int burst;
+            if (UART0_FR & UART0_FR_TXFE) {
+                // FIFO drained: refill all 16 entries in one go
+                burst = len < PL011_FIFO_DEPTH ? len : PL011_FIFO_DEPTH;
+            } else if (!(UART0_FR & UART0_FR_TXFF)) {
+                burst = 1;
+            } else {
+                continue;
+            }
+            len -= burst;
+            while (burst--)
+                UART0_DR = *buf++;
+        }
+    } else {
+        while (len) {
+            // bits 27-24: transmit FIFO fill level (0-8)
+            unsigned int space = MINI_UART_FIFO_DEPTH - ((AUX_MU_STAT >> 24) & 0xF);
+            unsigned int burst = len < space ? len : space;
+            len -= burst;
+            while (burst--)
+                AUX_MU_IO = *buf++;
+        }
+    }
+}
+
+/**
+ * Send a raw block of bytes (collected while batching)
+ */
+void uart_write(const char *buf, unsigned int len)
+{
+    if (!batch_buf) {
+        uart_write_fifo(buf, len);
+        return;
+    }
+    while (len) {
+        if (batch_len == batch_size)
+            uart_batch_flush();
+        unsigned int n = batch_size - batch_len;
+        if (n > len)
+            n = len;
+        for (unsigned int i = 0; i < n; i++)
+            batch_buf[batch_len + i] = buf[i];
+        batch_len += n;
+        buf += n;
+        len -= n;
+    }
 }
 
 /**
  * Send a character
  */
 void uart_sendc(char c) {
+    if (batch_buf) {
+        uart_write(&c, 1);
+        return;
+    }
+    STAT_INC(uart_stats.tx_bytes);
+    if (console_port == UART_PL011) {
+        if (dma_tx_active)
+            uart_dma_wait();
+
+        // wait until there is room in the transmit FIFO
+        do {
+            asm volatile("nop");
+        } while (UART0_FR & UART0_FR_TXFF);
+
+        UART0_DR = c;
+        return;
+    }
+
     // wait until transmitter is empty
     do {
     	asm volatile("nop");
@@ -70,12 +276,173 @@ void uart_sendc(char c) {
     AUX_MU_IO = c;
 }
 
+/**
+ * Start sending a block of words (one character in the low byte of each) by DMA,
+ * paced by the PL011 transmit DREQ. Waits for the previous transfer first.
+ * The buffer must stay untouched until uart_dma_busy() returns 0.
+ * Returns 0 if DMA is unavailable (mini UART console has no DREQ).
+ */
+int uart_dma_write(const unsigned int *words, unsigned int count)
+{
+    if (!dma_tx_ready)
+        return 0;
+    uart_dma_wait();
+    if (count == 0)
+        return 1;
+
+    dma_tx_cb.ti = DMA_TI_SRC_INC | DMA_TI_DEST_DREQ | DMA_TI_WAIT_RESP
+                 | DMA_TI_PERMAP(DMA_DREQ_UART_TX) | DMA_TI_NO_WIDE_BURSTS;
+    dma_tx_cb.source_ad = DMA_BUS_MEM(words);
+    dma_tx_cb.dest_ad = DMA_BUS_PERIPH(&UART0_DR);
+    dma_tx_cb.txfr_len = count * 4;
+    dma_tx_cb.stride = 0;
+    dma_tx_cb.nextconbk = 0;
+
+    dma_tx_active = 1;
+    dma_start(DMA_CH_UART, &dma_tx_cb);
+    STAT_ADD(uart_stats.tx_bytes, count);
+    return 1;
+}
+
+/**
+ * Is a DMA transmit still in flight? Returns 0 once the last buffer
+ * handed to uart_dma_write() may be reused.
+ */
+int uart_dma_busy()
+{
+    if (dma_tx_active && !dma_busy(DMA_CH_UART)) {
+        dma_done(DMA_CH_UART);
+        dma_tx_active = 0;
+        dma_tx_completed++;
+    }
+    return dma_tx_active;
+}
+
+/**
+ * Number of DMA transmits completed so far
+ */
+unsigned int uart_dma_completed()
+{
+    uart_dma_busy();
+    return dma_tx_completed;
+}
+
+/**
+ * Wait for the DMA transmit in flight (if any) to complete
+ */
+void uart_dma_wait()
+{
+    while (uart_dma_busy())
+        asm volatile("nop");
+}
+
+/**
+ * Display a string using DMA when the console supports it. The text is copied
+ * into a staging buffer, so the caller's string can be reused immediately and
+ * long outputs cost the CPU one word store per character.
+ */
+void uart_dma_puts(char *s)
+{
+    if (!dma_tx_ready || batch_buf) {
+        uart_puts(s);
+        return;
+    }
+
+    while (*s) {
+        unsigned int *buf = dma_tx_buf[dma_tx_next];
+        unsigned int n = 0;
+
+        // fill the idle buffer while the other one is being transmitted
+        while (*s && n < UART_DMA_BUF_WORDS - 1) {
+            // convert newline to carriage return + newline
+            if (*s == '\n')
+                buf[n++] = '\r';
+            buf[n++] = (unsigned char)*s++;
+        }
+        uart_dma_write(buf, n);
+        dma_tx_next ^= 1;
+    }
+}
+
+/**
+ * Collect all further output in buf (size bytes) until uart_batch_end(),
+ * sending it whenever buf fills up. Runs of small writes then cost one
+ * DMA transfer per buffer, which overlaps with the code producing the
+ * next one (on the mini UART the block goes out through the FIFO).
+ */
+void uart_batch_begin(char *buf, unsigned int size)
+{
+    uart_batch_end();
+    batch_len = 0;
+    batch_size = size;
+    batch_buf = buf;
+}
+
+/**
+ * Send what has been collected so far (when batching)
+ */
+void uart_batch_flush()
+{
+    const char *p = batch_buf;
+    unsigned int len = batch_len;
+
+    batch_len = 0;
+    if (!dma_tx_ready) {
+        uart_write_fifo(p, len);
+        return;
+    }
+    while (len) {
+        // the other staging buffer may still be on the wire
+        unsigned int *words = dma_tx_buf[dma_tx_next];
+        unsigned int n = len < UART_DMA_BUF_WORDS ? len : UART_DMA_BUF_WORDS;
+        for (unsigned int i = 0; i < n; i++)
+            words[i] = (unsigned char)p[i];
+        uart_dma_write(words, n);
+        dma_tx_next ^= 1;
+        p += n;
+        len -= n;
+    }
+}
+
+/**
+ * Send the rest of the batch and go back to unbuffered output. The last
+ * DMA transfer may still be running (see uart_dma_wait).
+ */
+void uart_batch_end()
+{
+    if (batch_buf) {
+        uart_batch_flush();
+        batch_buf = 0;
+    }
+}
+
+/**
+ * A received character is waiting (uart_getc() will not block)
+ */
+int uart_rx_ready() {
+    if (console_port == UART_PL011)
+        return !(UART0_FR & UART0_FR_RXFE);
+    return AUX_MU_LSR & 0x01;
+}
+
 /**
  * Receive a character
  */
 char uart_getc() {
     char c;
 
+    STAT_INC(uart_stats.rx_bytes);
+
+    if (console_port == UART_PL011) {
+        // wait until the receive FIFO has data
+        do {
+            asm volatile("nop");
+        } while (UART0_FR & UART0_FR_RXFE);
+
+        c = (unsigned char)(UART0_DR);
+        return (c == '\r' ? '\n' : c);
+    }
+
     // wait until data is ready (one symbol)
     do {
     	asm volatile("nop");
@@ -89,15 +456,35 @@ char uart_getc() {
 }
 
 /**
- * Display a string
+ * Display the first len characters of a string
  */
-void uart_puts(char *s) {
-    while (*s) {
+void uart_putn(const char *s, unsigned int len) {
+    char chunk[64];
+    unsigned int n = 0;
+
+    while (len--) {
         // convert newline to carriage return + newline
         if (*s == '\n')
-            uart_sendc('\r');
-        uart_sendc(*s++);
+            chunk[n++] = '\r';
+        chunk[n++] = *s++;
+
+        // leave room for a "\r\n" pair before flushing the chunk
+        if (n >= sizeof(chunk) - 1) {
+            uart_write(chunk, n);
+            n = 0;
+        }
     }
+    uart_write(chunk, n);
+}
+
+/**
+ * Display a string
+ */
+void uart_puts(char *s) {
+    unsigned int len = 0;
+    while (s[len])
+        len++;
+    uart_putn(s, len);
 }
 
 
@@ -105,17 +492,13 @@ void uart_puts(char *s) {
 * Display a value in hexadecimal format
 */
 void uart_hex(unsigned int num) {
-	uart_puts("0x");
-	for (int pos = 28; pos >= 0; pos = pos - 4) {
-
-		// Get highest 4-bit nibble
-		char digit = (num >> pos) & 0xF;
+	char str[2 + 8];
 
-		/* Convert to ASCII code */
-		// 0-9 => '0'-'9', 10-15 => 'A'-'F'
-		digit += (digit > 9) ? (-10 + 'A') : '0';
-		uart_sendc(digit);
-	}
+	// 0-9 => '0'-'9', 10-15 => 'A'-'F', always 8 digits
+	char *p = fmt_u64_hex(str + sizeof(str), num, 1, 8);
+	*--p = 'x';
+	*--p = '0';
+	uart_write(str, sizeof(str));
 }
 
 /*
@@ -124,24 +507,9 @@ void uart_hex(unsigned int num) {
 */
 void uart_dec(int num)
 {
-	//A string to store the digit characters
-	char str[33] = "";
-
-	//Calculate the number of digits
-	int len = 1;
-	int temp = num;
-	while (temp >= 10){
-		len++;
-		temp = temp / 10;
-	}
-
-	//Store into the string and print out
-	for (int i = 0; i < len; i++){
-		int digit = num % 10; //get last digit
-		num = num / 10; //remove last digit from the number
-		str[len - (i + 1)] = digit + '0';
-	}
-	str[len] = '\0';
-
-	uart_puts(str);
-}
\ No newline at end of file
+	//A string to store the digit characters (sign included)
+	char str[NUMFMT_MAX_CHARS];
+
+	char *p = fmt_i64_dec(str + sizeof(str), num);
+	uart_write(p, str + sizeof(str) - p);
+}
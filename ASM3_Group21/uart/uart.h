@@ -14,10 +14,67 @@
 #define AUX_MU_STAT     (* (volatile unsigned int*)(MMIO_BASE+0x00215064))
 #define AUX_MU_BAUD     (* (volatile unsigned int*)(MMIO_BASE+0x00215068))
 
+/* PL011 UART (UART0) registers */
+#define UART0_DR        (* (volatile unsigned int*)(MMIO_BASE+0x00201000))
+#define UART0_FR        (* (volatile unsigned int*)(MMIO_BASE+0x00201018))
+#define UART0_IBRD      (* (volatile unsigned int*)(MMIO_BASE+0x00201024))
+#define UART0_FBRD      (* (volatile unsigned int*)(MMIO_BASE+0x00201028))
+#define UART0_LCRH      (* (volatile unsigned int*)(MMIO_BASE+0x0020102C))
+#define UART0_CR        (* (volatile unsigned int*)(MMIO_BASE+0x00201030))
+#define UART0_IFLS      (* (volatile unsigned int*)(MMIO_BASE+0x00201034))
+#define UART0_IMSC      (* (volatile unsigned int*)(MMIO_BASE+0x00201038))
+#define UART0_ICR       (* (volatile unsigned int*)(MMIO_BASE+0x00201044))
+#define UART0_DMACR     (* (volatile unsigned int*)(MMIO_BASE+0x00201048))
+
+/* PL011 flag register bits */
+#define UART0_FR_BUSY   (1 << 3) //transmitting data
+#define UART0_FR_RXFE   (1 << 4) //receive FIFO empty
+#define UART0_FR_TXFF   (1 << 5) //transmit FIFO full
+#define UART0_FR_TXFE   (1 << 7) //transmit FIFO empty
+
+/* FIFO depths (bytes) */
+#define PL011_FIFO_DEPTH    16
+#define MINI_UART_FIFO_DEPTH 8
+
+/* DMA transmit staging buffer size (one character per 32-bit word) */
+#define UART_DMA_BUF_WORDS  1024
+
+/* Clocks feeding the baud rate generators */
+#define UART0_CLOCK     48000000  //PL011 reference clock, set via mailbox (allows up to 3Mbaud)
+#define SYSTEM_CLOCK    250000000 //core clock driving the mini UART
+
+/* Console ports */
+#define UART_PL011  0
+#define UART_MINI   1
+
+/* Compile-time console selection, override with e.g.
+   make UART_FLAGS="-DUART_CONSOLE=UART_PL011 -DUART_BAUD=921600" */
+#ifndef UART_CONSOLE
+#define UART_CONSOLE UART_MINI
+#endif
+#ifndef UART_BAUD
+#define UART_BAUD 115200
+#endif
+
 /* Function prototypes */
 void uart_init();
+int uart_config(int port, unsigned int baud);
+int uart_port();
+unsigned int uart_baud();
+void uart_flush();
+void uart_write(const char *buf, unsigned int len);
 void uart_sendc(char c);
+int uart_dma_write(const unsigned int *words, unsigned int count);
+int uart_dma_busy();
+unsigned int uart_dma_completed();
+void uart_dma_wait();
+void uart_dma_puts(char *s);
+void uart_batch_begin(char *buf, unsigned int size);
+void uart_batch_flush();
+void uart_batch_end();
+int uart_rx_ready();
 char uart_getc();
+void uart_putn(const char *s, unsigned int len);
 void uart_puts(char *s);
 void uart_hex(unsigned int num);
-void uart_dec(int num);
\ No newline at end of file
+void uart_dec(int num);